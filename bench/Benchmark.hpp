@@ -0,0 +1,99 @@
+/**
+ * @file Benchmark.hpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#ifndef BENCH_BENCHMARK_HPP_
+#define BENCH_BENCHMARK_HPP_
+
+#include <chrono>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef BENCH_TEMP_PREFIX
+#define BENCH_TEMP_PREFIX "."
+#endif
+#define BENCH_FILE(bench_str) BENCH_TEMP_PREFIX "/" bench_str
+
+namespace sweet {
+namespace bench {
+
+/**
+ * A registered benchmark.
+ */
+struct Benchmark {
+	const char *name;
+	void (*run)();
+};
+
+/**
+ * @brief All registered benchmarks
+ */
+inline std::vector<Benchmark> &benchmarks() {
+	static std::vector<Benchmark> list;
+	return list;
+}
+
+/**
+ * Registers a benchmark on construction. Use through SWEET_BENCHMARK.
+ */
+struct BenchmarkRegistrar {
+	BenchmarkRegistrar(const char *name, void (*run)()) {
+		benchmarks().push_back( { name, run });
+	}
+};
+
+/**
+ * @brief Runs fn and tells how long it took, in seconds.
+ */
+template<typename FUNCTION>
+inline double measure(FUNCTION &&fn) {
+	auto start = std::chrono::steady_clock::now();
+	fn();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+/**
+ * @brief Outputs a result line.
+ * @param name the benchmark name
+ * @param operations how many operations were made
+ * @param seconds how long it took
+ */
+inline void report(std::string const &name, size_t operations, double seconds) {
+	std::cout << name << ',' << operations << ',' << seconds << ',' << operations / seconds << '\n';
+}
+
+/**
+ * @brief Creates (or overwrites) a file with the given content.
+ */
+inline void populateFile(const char *path, std::string const &content) {
+	std::ofstream f { path, std::ios_base::binary };
+	f << content;
+}
+
+/**
+ * @brief Creates (or overwrites) a file of lines, of about size characters.
+ */
+inline void populateLines(const char *path, size_t size) {
+	std::string line = "A line of a large file, long enough to fill some columns.\n";
+	std::ofstream f { path, std::ios_base::binary };
+	for (size_t written = 0; written < size; written += line.size()) {
+		f << line;
+	}
+}
+
+}  // namespace bench
+}  // namespace sweet
+
+#define SWEET_BENCHMARK(name) \
+	static void name(); \
+	static sweet::bench::BenchmarkRegistrar name##_registrar { #name, name }; \
+	static void name()
+
+#endif /* BENCH_BENCHMARK_HPP_ */
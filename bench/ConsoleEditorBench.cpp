@@ -0,0 +1,116 @@
+/**
+ * @file ConsoleEditorBench.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../src/ConsoleEditor.hpp"
+#include "../src/MemoryTarget.hpp"
+#include "../src/MmapTarget.hpp"
+#include "../src/ReadOnlyTarget.hpp"
+#include "Benchmark.hpp"
+
+using namespace std;
+using namespace sweet;
+using namespace sweet::bench;
+
+/**
+ * Dispatches a million line script of cheap commands, so the time is
+ * dominated by the command lookup and call.
+ */
+SWEET_BENCHMARK(dispatch_million_lines) {
+	auto path = BENCH_FILE("dispatch.txt");
+	populateFile(path, "Hello World");
+	ConsoleEditor<MemoryTarget> editor { path };
+	size_t custom = 0;
+	editor.registerCustomCommand('#', [&custom](auto) {
+		++custom;
+		return ConsoleEditor<MemoryTarget>::Change::NONE;
+	});
+	const char *lines[] = { "f", "l", "#", "M", "m", "M" };
+	vector<string> script;
+	for (size_t i = 0; i < 1000000; ++i) {
+		script.emplace_back(lines[i % 6]);
+	}
+	double seconds = measure([&] {
+		for (auto &line : script) {
+			editor.update(line);
+		}
+	});
+	report("dispatch_million_lines", script.size(), seconds);
+}
+
+/**
+ * Replays a million line editing session, mostly commands with arguments,
+ * so the argument parsing shows up.
+ */
+SWEET_BENCHMARK(replay_editing_script) {
+	auto path = BENCH_FILE("replay.txt");
+	populateFile(path, "Hello World");
+	ConsoleEditor<MemoryTarget> editor { path };
+	const char *lines[] = { "f", "g4", "ixyz", "g-2", "d3", "wab", "l", "g-6" };
+	vector<string> script;
+	for (size_t i = 0; i < 1000000; ++i) {
+		//Saving collapses the tree, so it does not grow forever.
+		script.emplace_back(i % 1000 == 999 ? "s" : lines[i % 8]);
+	}
+	double seconds = measure([&] {
+		for (auto &line : script) {
+			editor.update(line);
+		}
+	});
+	report("replay_editing_script", script.size(), seconds);
+}
+
+/**
+ * Opens a 64MB file and renders frames all over it, counting the open.
+ */
+template<typename TARGET>
+static void viewLargeFile(const char *name) {
+	auto path = BENCH_FILE("view_large.txt");
+	populateLines(path, 64 * 1024 * 1024);
+	constexpr size_t FRAMES = 1000;
+	ostringstream out;
+	double seconds = measure([&] {
+		ConsoleEditor<TARGET> editor { path };
+		string jump = "g" + to_string(64 * 1024 * 1024 / FRAMES);
+		for (size_t i = 0; i < FRAMES; ++i) {
+			editor.update(jump);
+			editor.render(out);
+			out.str("");
+		}
+	});
+	report(name, FRAMES, seconds);
+}
+
+SWEET_BENCHMARK(view_large_file_memory) {
+	viewLargeFile<MemoryTarget>("view_large_file_memory");
+}
+
+SWEET_BENCHMARK(view_large_file_mmap) {
+	viewLargeFile<MmapTarget>("view_large_file_mmap");
+}
+
+SWEET_BENCHMARK(view_large_file_readonly) {
+	viewLargeFile<ReadOnlyTarget>("view_large_file_readonly");
+}
+
+/**
+ * Opens a 256MB file and renders the first frame, which should not wait for
+ * the whole file to be indexed.
+ */
+SWEET_BENCHMARK(open_first_frame) {
+	auto path = BENCH_FILE("open_large.txt");
+	populateLines(path, 256 * 1024 * 1024);
+	ostringstream out;
+	double seconds = measure([&] {
+		ConsoleEditor<MemoryTarget> editor { path };
+		editor.render(out);
+	});
+	report("open_first_frame", 1, seconds);
+}
@@ -0,0 +1,91 @@
+/**
+ * @file FileTargetBench.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+
+#include "../src/FileTarget.hpp"
+#include "Benchmark.hpp"
+
+using namespace std;
+using namespace sweet;
+using namespace sweet::bench;
+
+static constexpr size_t FILE_TARGET_SIZE = 16 * 1024 * 1024;
+
+SWEET_BENCHMARK(file_open) {
+	auto path = BENCH_FILE("file_open.txt");
+	populateLines(path, FILE_TARGET_SIZE);
+	constexpr size_t count = 1000;
+	double seconds = measure([&] {
+		for (size_t i = 0; i < count; ++i) {
+			FileTarget target(path);
+		}
+	});
+	report("file_open", count, seconds);
+}
+
+SWEET_BENCHMARK(file_replace_sequential) {
+	auto path = BENCH_FILE("file_replace.txt");
+	populateLines(path, FILE_TARGET_SIZE);
+	string block(4096, 'x');
+	double seconds = measure([&] {
+		FileTarget target(path);
+		for (size_t written = 0; written < FILE_TARGET_SIZE; written += block.size()) {
+			target.replace(block.begin(), block.end());
+		}
+		target.flush();
+	});
+	report("file_replace_sequential", FILE_TARGET_SIZE, seconds);
+}
+
+SWEET_BENCHMARK(file_replace_random) {
+	auto path = BENCH_FILE("file_replace.txt");
+	populateLines(path, FILE_TARGET_SIZE);
+	string text = "some words";
+	constexpr size_t count = 100000;
+	minstd_rand random;
+	double seconds = measure([&] {
+		FileTarget target(path);
+		for (size_t i = 0; i < count; ++i) {
+			target.toStart();
+			target.go(random() % (FILE_TARGET_SIZE - text.size()));
+			target.replace(text.begin(), text.end());
+		}
+		target.flush();
+	});
+	report("file_replace_random", count, seconds);
+}
+
+SWEET_BENCHMARK(file_view_range) {
+	auto path = BENCH_FILE("file_view.txt");
+	populateLines(path, FILE_TARGET_SIZE);
+	FileTarget target(path);
+	string content;
+	content.reserve(FILE_TARGET_SIZE);
+	double seconds = measure([&] {
+		target.viewRange(0, FILE_TARGET_SIZE, back_inserter(content));
+	});
+	report("file_view_range", content.size(), seconds);
+}
+
+SWEET_BENCHMARK(file_read_range) {
+	auto path = BENCH_FILE("file_view.txt");
+	populateLines(path, FILE_TARGET_SIZE);
+	FileTarget target(path);
+	constexpr size_t BLOCK_SIZE = 64 * 1024;
+	unique_ptr<char[]> buffer(new char[BLOCK_SIZE]);
+	size_t total = 0;
+	double seconds = measure([&] {
+		for (size_t read; (read = target.readRange(total, BLOCK_SIZE, buffer.get())) > 0;) {
+			total += read;
+		}
+	});
+	report("file_read_range", total, seconds);
+}
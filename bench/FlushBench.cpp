@@ -0,0 +1,78 @@
+/**
+ * @file FlushBench.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include <string>
+
+#include "../src/MemoryTarget.hpp"
+#include "Benchmark.hpp"
+
+using namespace std;
+using namespace sweet;
+using namespace sweet::bench;
+
+static constexpr size_t FLUSH_FILE_SIZE = 64 * 1024 * 1024;
+
+/**
+ * Opens a 64MB file, makes count edits by edit(target, i) and measures the flush.
+ */
+template<typename EDIT>
+static void flushEdits(const char *name, size_t count, EDIT edit) {
+	auto path = BENCH_FILE("flush.txt");
+	populateLines(path, FLUSH_FILE_SIZE);
+	MemoryTarget target(path);
+	for (size_t i = 0; i < count; ++i) {
+		edit(target, i);
+	}
+	double seconds = measure([&] {
+		target.flush();
+	});
+	report(name, count, seconds);
+}
+
+SWEET_BENCHMARK(flush_append) {
+	string text = "appended text\n";
+	flushEdits("flush_append", 1000, [&](MemoryTarget &target, size_t) {
+		target.toEnd();
+		target.insert(text.begin(), text.end());
+	});
+}
+
+SWEET_BENCHMARK(flush_clustered) {
+	string text = "word ";
+	flushEdits("flush_clustered", 1000, [&](MemoryTarget &target, size_t i) {
+		target.toStart();
+		target.go(i * 7919 % (1024 * 1024));
+		target.insert(text.begin(), text.end());
+	});
+}
+
+SWEET_BENCHMARK(flush_scattered) {
+	string text = "word ";
+	flushEdits("flush_scattered", 1000, [&](MemoryTarget &target, size_t i) {
+		target.toStart();
+		target.go(i * 7919 * 1021 % target.size());
+		target.insert(text.begin(), text.end());
+	});
+}
+
+SWEET_BENCHMARK(flush_erase_scattered) {
+	flushEdits("flush_erase_scattered", 1000, [&](MemoryTarget &target, size_t i) {
+		target.toStart();
+		target.go(i * 7919 * 1021 % target.size());
+		target.erase(7);
+	});
+}
+
+SWEET_BENCHMARK(flush_insert_file) {
+	auto source = BENCH_FILE("flush_source.txt");
+	populateLines(source, FLUSH_FILE_SIZE);
+	flushEdits("flush_insert_file", 1, [&](MemoryTarget &target, size_t) {
+		target.toStart();
+		target.go(target.size() / 2);
+		target.insertFile(source);
+	});
+}
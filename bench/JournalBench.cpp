@@ -0,0 +1,64 @@
+/**
+ * @file JournalBench.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "../src/MemoryTarget.hpp"
+#include "Benchmark.hpp"
+
+using namespace std;
+using namespace sweet;
+using namespace sweet::bench;
+
+/**
+ * Makes small inserts all over a 1MB file, with the target built by make.
+ */
+template<typename MAKE>
+static void insertJournaled(const char *name, size_t count, MAKE make) {
+	auto path = BENCH_FILE("journaled.txt");
+	{
+		ofstream f { path, ios_base::binary };
+		f << string(1024 * 1024, 'x');
+	}
+	remove((string(path) + ".journal").c_str());
+	string text = "word ";
+	double seconds = measure([&] {
+		auto target = make(path);
+		for (size_t i = 0; i < count; ++i) {
+			target->toStart();
+			target->go(i * 7919 % target->size());
+			target->insert(text.begin(), text.end());
+		}
+	});
+	report(name, count, seconds);
+}
+
+SWEET_BENCHMARK(journal_none) {
+	insertJournaled("journal_none", 100000, [](const char *path) {
+		return make_unique<MemoryTarget>(path);
+	});
+}
+
+SWEET_BENCHMARK(journal_sync_never) {
+	insertJournaled("journal_sync_never", 100000, [](const char *path) {
+		return make_unique<MemoryTarget>(path, MemoryTarget::Options { true, Journal::Sync::NEVER });
+	});
+}
+
+SWEET_BENCHMARK(journal_sync_periodic) {
+	insertJournaled("journal_sync_periodic", 100000, [](const char *path) {
+		return make_unique<MemoryTarget>(path, MemoryTarget::Options { true, Journal::Sync::PERIODIC });
+	});
+}
+
+SWEET_BENCHMARK(journal_sync_each) {
+	insertJournaled("journal_sync_each", 1000, [](const char *path) {
+		return make_unique<MemoryTarget>(path, MemoryTarget::Options { true, Journal::Sync::EACH });
+	});
+}
@@ -0,0 +1,40 @@
+/**
+ * @file LineIndexBench.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include <string>
+
+#include "../src/LineIndex.hpp"
+#include "Benchmark.hpp"
+
+using namespace std;
+using namespace sweet;
+using namespace sweet::bench;
+
+/**
+ * Indexes 256MB of text, reporting bytes per second. It uses a thread per
+ * core, so the result scales with the machine.
+ */
+static void indexContent(const char *name, string const &line) {
+	string content;
+	content.reserve(256 * 1024 * 1024 + line.size());
+	while (content.size() < 256 * 1024 * 1024) {
+		content += line;
+	}
+	LineIndex index;
+	double seconds = measure([&] {
+		index.build(content.data(), content.size());
+	});
+	report(name, content.size(), seconds);
+}
+
+SWEET_BENCHMARK(line_index_ascii) {
+	indexContent("line_index_ascii", "The quick brown fox jumps over the lazy dog\n");
+}
+
+SWEET_BENCHMARK(line_index_utf8) {
+	indexContent("line_index_utf8", "\xc3\x9c" "n\xc3\xaf" "c\xc3\xb6" "d\xc3\xa9 t\xc3\xa9" "xt \xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e\n");
+}
@@ -0,0 +1,173 @@
+/**
+ * @file MemoryTargetBench.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <iterator>
+#include <random>
+#include <string>
+
+#include <unistd.h>
+
+#include "../src/MemoryTarget.hpp"
+#include "Benchmark.hpp"
+
+using namespace std;
+using namespace sweet;
+using namespace sweet::bench;
+
+static constexpr size_t MEMORY_TARGET_SIZE = 16 * 1024 * 1024;
+
+/**
+ * Measures opening a file of the given size and showing its first screen.
+ *
+ * Only the first MB has content; the rest is a hole, so even the largest
+ * files take no disc space. Opening must not depend on the file size.
+ */
+static void openFile(const char *name, size_t size) {
+	auto path = BENCH_FILE("memory_open.txt");
+	populateLines(path, min<size_t>(size, 1024 * 1024));
+	if (truncate(path, size) < 0) {
+		return;
+	}
+	constexpr size_t count = 10;
+	string screen;
+	double seconds = measure([&] {
+		for (size_t i = 0; i < count; ++i) {
+			MemoryTarget target(path);
+			screen.clear();
+			target.view(80 * 50, back_inserter(screen));
+		}
+	});
+	report(name, count, seconds);
+	remove(path);
+}
+
+SWEET_BENCHMARK(memory_open_1KB) {
+	openFile("memory_open_1KB", 1024);
+}
+
+SWEET_BENCHMARK(memory_open_1MB) {
+	openFile("memory_open_1MB", 1024 * 1024);
+}
+
+SWEET_BENCHMARK(memory_open_1GB) {
+	openFile("memory_open_1GB", 1024 * 1024 * 1024);
+}
+
+SWEET_BENCHMARK(memory_open_10GB) {
+	openFile("memory_open_10GB", 10ul * 1024 * 1024 * 1024);
+}
+
+/**
+ * Opens a 16MB file and measures count edits by edit(target, random).
+ */
+template<typename EDIT>
+static void editFile(const char *name, size_t count, EDIT edit) {
+	auto path = BENCH_FILE("memory_edit.txt");
+	populateLines(path, MEMORY_TARGET_SIZE);
+	MemoryTarget target(path);
+	minstd_rand random;
+	double seconds = measure([&] {
+		for (size_t i = 0; i < count; ++i) {
+			edit(target, random);
+		}
+	});
+	report(name, count, seconds);
+}
+
+SWEET_BENCHMARK(memory_insert_sequential) {
+	editFile("memory_insert_sequential", 1000000, [](MemoryTarget &target, minstd_rand&) {
+		char ch = 'x';
+		target.insert(&ch, &ch + 1);
+	});
+}
+
+SWEET_BENCHMARK(memory_insert_random) {
+	string text = "word ";
+	editFile("memory_insert_random", 100000, [&](MemoryTarget &target, minstd_rand &random) {
+		target.toStart();
+		target.go(random() % target.size());
+		target.insert(text.begin(), text.end());
+	});
+}
+
+SWEET_BENCHMARK(memory_erase_storm) {
+	editFile("memory_erase_storm", 100000, [](MemoryTarget &target, minstd_rand &random) {
+		target.toStart();
+		target.go(random() % target.size());
+		target.erase(1 + random() % 16);
+	});
+}
+
+SWEET_BENCHMARK(memory_copy_paste) {
+	editFile("memory_copy_paste", 10000, [](MemoryTarget &target, minstd_rand &random) {
+		target.toStart();
+		target.go(random() % (target.size() / 2));
+		target.copy(64 * 1024);
+		target.toStart();
+		target.go(random() % target.size());
+		target.paste();
+	});
+}
+
+SWEET_BENCHMARK(memory_move) {
+	editFile("memory_move", 10000, [](MemoryTarget &target, minstd_rand &random) {
+		target.move(random() % (target.size() / 2), 64 * 1024, random() % target.size());
+	});
+}
+
+/**
+ * Makes 10000 scattered edits on a 16MB file, then measures reading it all by read(target).
+ */
+template<typename READ>
+static void readFile(const char *name, READ read) {
+	auto path = BENCH_FILE("memory_view.txt");
+	populateLines(path, MEMORY_TARGET_SIZE);
+	MemoryTarget target(path);
+	minstd_rand random;
+	string text = "word ";
+	for (size_t i = 0; i < 10000; ++i) {
+		target.toStart();
+		target.go(random() % target.size());
+		target.insert(text.begin(), text.end());
+	}
+	size_t total = 0;
+	double seconds = measure([&] {
+		total = read(target);
+	});
+	report(name, total, seconds);
+}
+
+SWEET_BENCHMARK(memory_view_range) {
+	readFile("memory_view_range", [](MemoryTarget &target) {
+		string content;
+		content.reserve(target.size());
+		target.viewRange(0, target.size(), back_inserter(content));
+		return content.size();
+	});
+}
+
+SWEET_BENCHMARK(memory_for_each_segment) {
+	readFile("memory_for_each_segment", [](MemoryTarget &target) {
+		size_t total = 0;
+		target.forEachSegment(0, target.size(), [&total](const char *first, const char *last) {
+			total += last - first;
+			return true;
+		});
+		return total;
+	});
+}
+
+SWEET_BENCHMARK(memory_iterate) {
+	readFile("memory_iterate", [](MemoryTarget &target) {
+		//Only a MB, as it goes a character at a time.
+		constexpr size_t size = 1024 * 1024;
+		size_t newlines = count(target.begin(), target.begin() + size, '\n');
+		return newlines > 0 ? size : 0;
+	});
+}
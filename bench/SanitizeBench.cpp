@@ -0,0 +1,70 @@
+/**
+ * @file SanitizeBench.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include <random>
+#include <string>
+
+#include "../src/Sanitize.hpp"
+#include "Benchmark.hpp"
+
+using namespace std;
+using namespace sweet;
+using namespace sweet::bench;
+
+/**
+ * Sanitizes a 16MB buffer with each policy, reporting bytes per second.
+ */
+static void sanitizeAll(const char *name, string const &content) {
+	const pair<const char*, DisplayPolicy> policies[] = {
+		{ "replace", DisplayPolicy::REPLACE },
+		{ "caret", DisplayPolicy::CARET },
+		{ "hex", DisplayPolicy::HEX },
+		{ "utf8", DisplayPolicy::UTF8 },
+	};
+	for (auto &policy : policies) {
+		string out;
+		double seconds = measure([&] {
+			sanitize(content.data(), content.data() + content.size(), out, policy.second);
+		});
+		report(string(name) + "_" + policy.first, content.size(), seconds);
+	}
+}
+
+/**
+ * Plain ASCII text, the path every frame takes for source code.
+ */
+SWEET_BENCHMARK(sanitize_text) {
+	string content;
+	while (content.size() < 16 * 1024 * 1024) {
+		content += "The quick brown fox jumps over the lazy dog. ";
+	}
+	sanitizeAll("sanitize_text", content);
+}
+
+/**
+ * Uniformly random bytes, like an executable or a compressed file.
+ */
+SWEET_BENCHMARK(sanitize_binary) {
+	mt19937 random { 42 };
+	string content(16 * 1024 * 1024, '\0');
+	for (auto &ch : content) {
+		ch = char(random());
+	}
+	sanitizeAll("sanitize_binary", content);
+}
+
+/**
+ * Text with a control character every 64 bytes, like tab indented code.
+ */
+SWEET_BENCHMARK(sanitize_sparse) {
+	string content;
+	while (content.size() < 16 * 1024 * 1024) {
+		content += '\t';
+		content.append(63, 'x');
+	}
+	sanitizeAll("sanitize_sparse", content);
+}
@@ -0,0 +1,29 @@
+/**
+ * @file main.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include <cstring>
+#include <iostream>
+
+#include "Benchmark.hpp"
+
+using namespace std;
+using namespace sweet::bench;
+
+/**
+ * Runs every benchmark, or only the ones containing the first argument on
+ * their names. Results are written as csv on the standard output.
+ */
+int main(int argc, char **argv) {
+	const char *filter = argc > 1 ? argv[1] : "";
+	cout << "benchmark,operations,seconds,operations_per_second" << endl;
+	for (auto &benchmark : benchmarks()) {
+		if (strstr(benchmark.name, filter)) {
+			benchmark.run();
+		}
+	}
+	return 0;
+}
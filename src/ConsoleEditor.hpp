@@ -8,13 +8,21 @@
 #ifndef SRC_CONSOLEEDITOR_HPP_
 #define SRC_CONSOLEEDITOR_HPP_
 
+#include <algorithm>
+#include <array>
+#include <charconv>
 #include <cstddef>
+#include <cstdio>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <string>
-#include <sstream>
-#include <unordered_map>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "Sanitize.hpp"
 #include "TargetTraits.hpp"
 
 namespace sweet {
@@ -35,6 +43,15 @@ inline std::string textViewTarget(TARGET &target, long pos, long size, appendabl
 	return content;
 }
 template<class TARGET>
+inline std::string textViewTarget(TARGET &target, long pos, long size, random_access_target_tag){
+	size_t first = std::min(size_t(pos), target.size());
+	return std::string(target.data() + first, std::min(size_t(size), target.size() - first));
+}
+template<class TARGET>
+inline std::string textViewTarget(TARGET &target, long pos, long size, readonly_target_tag){
+	return textViewTarget(target, pos, size, random_access_target_tag{});
+}
+template<class TARGET>
 inline std::string textViewTarget(TARGET &target, long pos, long size, insertable_target_tag){
 	std::string content;
 	target.viewRange(pos, size, std::back_inserter(content));
@@ -47,41 +64,127 @@ inline std::string textViewTarget(TARGET &target, long pos, long size, insertabl
 template<typename TARGET>
 class ConsoleEditor {
 public:
-	using Command = std::function<void(std::string const &)>;
+	/**
+	 * What a command changes on the content.
+	 */
+	enum class Change {
+		NONE, ///< Nothing, it only navigates or queries.
+		AT_POSITION, ///< The content from the current position on.
+		ANYWHERE, ///< Anything.
+	};
+
+	/// A custom command, returning what it changed.
+	using Command = std::function<Change(std::string_view)>;
+	using Handler = void (*)(ConsoleEditor &editor, std::string_view line);
+
+	/**
+	 * @brief Ctor
+	 * @param fileName
+	 * @param args more arguments to the target constructor, if any.
+	 */
+	template<typename... ARGS>
+	ConsoleEditor(const std::string& fileName, ARGS&&... args);
 
-	ConsoleEditor(const std::string& fileName);
 	/**
 	 * Updates the file according with the given command.
 	 * @param line the command
 	 * @return true if it can receive a new command, false
 	 * otherwise.
 	 */
-	bool update(std::string const &line);
+	bool update(std::string_view line);
+
+	/**
+	 * Renders the view.
+	 *
+	 * The last frame is cached and only rebuilt when an edit touched the
+	 * visible range. Only the lines that changed since the last frame are
+	 * emitted, in a single write.
+	 * @param out
+	 */
 	void render(std::ostream& out);
 
 	/**
 	 * Adds a custom command.
+	 *
+	 * The command returns what it changed, so the view is refreshed when the
+	 * change touched it.
 	 */
-	void registerCustomCommand(char key, Command command) {
-		commands[key] = command;
-	}
+	void registerCustomCommand(char key, Command command);
+
+	/**
+	 * Sets the viewport size.
+	 * @param lines how many lines are shown around the cursor.
+	 * @param columns how many characters are shown of each line.
+	 */
+	void resize(size_t lines, size_t columns);
+
+	/**
+	 * Sets how the unprintable characters are displayed.
+	 */
+	void setDisplay(DisplayPolicy policy);
 private:
+	using RangeMethod = void (TARGET::*)(const char*, const char*);
+
 	TARGET target;
-	std::unordered_map<char, Command> commands;
+	/// Direct indexed by the command character. Empty entries are unknown commands.
+	std::array<Handler, 256> handlers { };
+	std::array<Change, 256> changes { };
+	std::array<Command, 256> customCommands;
+
+	/// The last rendered frame.
+	std::vector<std::string> frame;
+	/// The range of the content visible on the last frame.
+	size_t viewBegin = 0, viewEnd = 0;
+	/// The line of the cursor on the last frame, or its start on random access targets.
+	size_t cursorLine = 0;
+	/// If the visible range was touched since the last frame.
+	bool dirty = true;
+	/// The viewport size.
+	size_t viewLines = 20, viewColumns = 72;
+	/// How the unprintable characters are displayed.
+	DisplayPolicy display = DisplayPolicy::REPLACE;
 
 	/**
 	 * @brief register a target method as a command
+	 * @tparam METHOD the method to be called. It is bound at compile time,
+	 * so the handler calls it directly.
+	 * @tparam CHANGE what the method changes on the content. Only writable
+	 * targets can have commands that change something.
+	 * @param key the key to trigger the command
+	 */
+	template<auto METHOD, Change CHANGE = Change::NONE>
+	void registerMethod(char key);
+
+	/**
+	 * @brief register a command handler
 	 * @param key the key to trigger the command
+	 * @param handler
+	 * @param change what the handler changes on the content.
+	 */
+	void registerHandler(char key, Handler handler, Change change = Change::NONE);
+
+	/**
+	 * @brief Marks the frame to be rebuilt if the change may touch the visible range.
+	 * @param change what was changed.
+	 * @param pos the position before the change, used if it is Change::AT_POSITION.
+	 */
+	void touch(Change change, size_t pos);
+
+	/**
+	 * @brief Calls a target method with the arguments parsed from the command line.
+	 *
+	 * The arguments are views on the line, so no allocation is made.
 	 * @param method the method to be called.
+	 * @param line the command line.
 	 * @{
 	 */
 	template<typename RETURN>
-	void registerMethod(char key, RETURN (TARGET::*method)() const);
-	void registerMethod(char key, void (TARGET::*method)());
-	void registerMethod(char key, void (TARGET::*method)(const std::string&));
+	void call(RETURN (TARGET::*method)() const, std::string_view line);
+	void call(void (TARGET::*method)(), std::string_view line);
+	void call(void (TARGET::*method)(std::string_view), std::string_view line);
 	template<typename PARAM>
-	void registerMethod(char key, void (TARGET::*method)(PARAM));
-	void registerMethod(char key, void (TARGET::*method)(std::string::const_iterator, std::string::const_iterator));
+	void call(void (TARGET::*method)(PARAM), std::string_view line);
+	void call(RangeMethod method, std::string_view line);
 	/// @}
 
 	/**
@@ -92,105 +195,403 @@ private:
 	 */
 	void initCommands(appendable_target_tag);
 	void initCommands(insertable_target_tag);
-	void renderTagged(std::ostream& out, appendable_target_tag);
-	void renderTagged(std::ostream& out, insertable_target_tag);
+	void initCommands(random_access_target_tag);
+	void initCommands(readonly_target_tag);
+	///@}
+
+	/**
+	 * @brief Initialize the paging commands of targets with data() and size().
+	 */
+	void initBufferPaging();
+
+	/**
+	 * @brief The G command, going to a one based line.
+	 */
+	static void goLineCommand(ConsoleEditor &editor, std::string_view line);
+
+	/**
+	 * @brief Builds the frame lines, already sanitized.
+	 *
+	 * Each line starts with a gutter, so a changed line emitted alone can
+	 * still be placed. Targets without a line index show the first
+	 * characters after their offset, the others show the lines around the
+	 * cursor. Random access targets find them by scanning the buffer around
+	 * the cursor, so their gutter shows offsets instead of line numbers. Read
+	 * only targets too, as their line index may still be in construction.
+	 * @{
+	 */
+	std::vector<std::string> buildFrame(appendable_target_tag);
+	std::vector<std::string> buildFrame(insertable_target_tag);
+	std::vector<std::string> buildFrame(random_access_target_tag);
+	std::vector<std::string> buildFrame(readonly_target_tag);
+	///@}
+
+	/**
+	 * @brief Tells if the viewport must follow the cursor since the last frame.
+	 * @{
+	 */
+	bool viewMoved(appendable_target_tag);
+	bool viewMoved(insertable_target_tag);
+	bool viewMoved(random_access_target_tag);
+	bool viewMoved(readonly_target_tag);
 	///@}
+
+	/**
+	 * @brief Where the line containing pos starts, on targets with data().
+	 */
+	size_t lineStartOf(size_t pos) const;
 };
 
 template<typename TARGET>
-inline ConsoleEditor<TARGET>::ConsoleEditor(const std::string& fileName) :
-		target(fileName) {
+template<typename... ARGS>
+inline ConsoleEditor<TARGET>::ConsoleEditor(const std::string& fileName, ARGS&&... args) :
+		target(fileName, std::forward<ARGS>(args)...) {
 	initCommands(typename TargetTrait<TARGET>::category { });
 }
 
+/**
+ * @brief Parses a number argument.
+ *
+ * Leading spaces and a '+' sign are accepted, as the stream extraction did.
+ * @param text the argument
+ * @param value receives the parsed number.
+ * @return true if it is a valid number.
+ */
+template<typename NUMBER>
+inline bool parseNumber(std::string_view text, NUMBER &value) {
+	static_assert(std::is_integral<NUMBER>::value, "Only integral parameters are supported");
+	auto first = text.data(), last = text.data() + text.size();
+	while (first != last && *first == ' ') {
+		++first;
+	}
+	if (first != last && *first == '+') {
+		++first;
+	}
+	auto result = std::from_chars(first, last, value);
+	return result.ec == std::errc() && first != last;
+}
+
 template<typename TARGET>
-inline bool ConsoleEditor<TARGET>::update(std::string const &line) {
-	using namespace std;
+inline bool ConsoleEditor<TARGET>::update(std::string_view line) {
 	char command = line.front();
-	if (commands.count(command)) {
-		commands[command](line);
+	Handler handler = handlers[static_cast<unsigned char>(command)];
+	if (handler) {
+		Change change = changes[static_cast<unsigned char>(command)];
+		size_t pos = change == Change::AT_POSITION ? target.tell() : 0;
+		handler(*this, line);
+		touch(change, pos);
 	} else {
 		std::cerr << "Command '" << command << "' unknown" << std::endl;
 	}
 	return true;
 }
 
+template<typename TARGET>
+inline void ConsoleEditor<TARGET>::registerCustomCommand(char key, Command command) {
+	customCommands[static_cast<unsigned char>(key)] = command;
+	registerHandler(key, [](ConsoleEditor &editor, std::string_view line) {
+		size_t pos = editor.target.tell();
+		editor.touch(editor.customCommands[static_cast<unsigned char>(line.front())](line), pos);
+	});
+}
+
+template<typename TARGET>
+inline void ConsoleEditor<TARGET>::touch(Change change, size_t pos) {
+	if (change == Change::ANYWHERE || (change == Change::AT_POSITION && pos <= viewEnd)) {
+		dirty = true;
+	}
+}
+
+template<typename TARGET>
+inline void ConsoleEditor<TARGET>::resize(size_t lines, size_t columns) {
+	viewLines = lines;
+	viewColumns = columns;
+	dirty = true;
+}
+
+template<typename TARGET>
+inline void ConsoleEditor<TARGET>::setDisplay(DisplayPolicy policy) {
+	display = policy;
+	dirty = true;
+}
+
+template<typename TARGET>
+inline void ConsoleEditor<TARGET>::registerHandler(char key, Handler handler, Change change) {
+	handlers[static_cast<unsigned char>(key)] = handler;
+	changes[static_cast<unsigned char>(key)] = change;
+}
+
 template<typename TARGET>
 inline void ConsoleEditor<TARGET>::render(std::ostream& out) {
-	std::string content = textViewTarget(target, 0, 60);
-	for (auto &ch : content) {
-		if (ch < 0x20 || ch >= 0x7f) {
-			ch = '?';
+	static const char separator[] = "=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-\n";
+	using category = typename TargetTrait<TARGET>::category;
+	if (!dirty && !viewMoved(category { })) {
+		return;
+	}
+	auto lines = buildFrame(category { });
+	bool full = lines.size() != frame.size();
+	std::string buffer;
+	for (size_t i = 0; i < lines.size(); ++i) {
+		if (full || lines[i] != frame[i]) {
+			buffer += lines[i];
+			buffer += '\n';
 		}
 	}
-	out << "=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-" << std::endl;
-	out << content << std::endl;
-	out << "=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-" << std::endl;
+	if (!buffer.empty()) {
+		buffer.insert(0, separator);
+		buffer += separator;
+		out.write(buffer.data(), buffer.size());
+	}
+	frame = std::move(lines);
+	dirty = false;
+}
+
+template<typename TARGET>
+inline std::vector<std::string> ConsoleEditor<TARGET>::buildFrame(appendable_target_tag) {
+	constexpr size_t VIEW_SIZE = 60;
+	std::string content = textViewTarget(target, 0, VIEW_SIZE);
+	char gutter[32];
+	snprintf(gutter, sizeof(gutter), "%10zu|", size_t(0));
+	std::string row = gutter;
+	sanitize(content.data(), content.data() + content.size(), row, display);
+	viewBegin = 0;
+	viewEnd = viewBegin + VIEW_SIZE;
+	return {row};
+}
+
+template<typename TARGET>
+inline std::vector<std::string> ConsoleEditor<TARGET>::buildFrame(insertable_target_tag) {
+	cursorLine = target.line();
+	size_t top = cursorLine > viewLines / 2 ? cursorLine - viewLines / 2 : 0;
+	//Counting all lines may wait for the whole index, so only the view is checked.
+	size_t lines = top + viewLines;
+	while (lines > 1 && !target.hasLine(lines - 1)) {
+		--lines;
+	}
+	if (top + viewLines > lines) {
+		top = lines > viewLines ? lines - viewLines : 0;
+	}
+	std::vector<std::string> rows;
+	std::string content;
+	size_t begin = viewBegin = target.lineStart(top);
+	for (size_t line = top; line < lines && line < top + viewLines; ++line) {
+		size_t end = target.lineStart(line + 1);
+		size_t length = end - begin - (line + 1 < lines ? 1 : 0);
+		char gutter[32];
+		snprintf(gutter, sizeof(gutter), "%6zu%c", line + 1, line == cursorLine ? '>' : '|');
+		content.clear();
+		target.viewRange(begin, std::min(length, viewColumns), std::back_inserter(content));
+		rows.emplace_back(gutter);
+		sanitize(content.data(), content.data() + content.size(), rows.back(), display);
+		begin = end;
+	}
+	viewEnd = begin;
+	return rows;
+}
+
+template<typename TARGET>
+inline std::vector<std::string> ConsoleEditor<TARGET>::buildFrame(random_access_target_tag) {
+	const char *data = target.data();
+	size_t size = target.size();
+	cursorLine = lineStartOf(std::min(size_t(target.tell()), size));
+	size_t top = cursorLine;
+	for (size_t i = 0; i < viewLines / 2 && top > 0; ++i) {
+		top = lineStartOf(top - 1);
+	}
+	std::vector<std::string> rows;
+	size_t begin = viewBegin = top;
+	for (size_t i = 0; i < viewLines && (begin < size || i == 0); ++i) {
+		auto newline = begin < size ? static_cast<const char*>(memchr(data + begin, '\n', size - begin)) : nullptr;
+		size_t end = newline ? newline - data : size;
+		char gutter[32];
+		snprintf(gutter, sizeof(gutter), "%10zu%c", begin, begin == cursorLine ? '>' : '|');
+		rows.emplace_back(gutter);
+		sanitize(data + begin, data + begin + std::min(end - begin, viewColumns), rows.back(), display);
+		begin = newline ? end + 1 : size;
+	}
+	viewEnd = begin;
+	return rows;
+}
+
+template<typename TARGET>
+inline std::vector<std::string> ConsoleEditor<TARGET>::buildFrame(readonly_target_tag) {
+	return buildFrame(random_access_target_tag { });
+}
+
+template<typename TARGET>
+inline size_t ConsoleEditor<TARGET>::lineStartOf(size_t pos) const {
+	if (pos == 0) {
+		return 0;
+	}
+	auto newline = static_cast<const char*>(memrchr(target.data(), '\n', pos));
+	return newline ? newline - target.data() + 1 : 0;
+}
+
+template<typename TARGET>
+inline bool ConsoleEditor<TARGET>::viewMoved(appendable_target_tag) {
+	return false;
+}
+
+template<typename TARGET>
+inline bool ConsoleEditor<TARGET>::viewMoved(insertable_target_tag) {
+	return target.line() != cursorLine;
+}
+
+template<typename TARGET>
+inline bool ConsoleEditor<TARGET>::viewMoved(random_access_target_tag) {
+	return lineStartOf(std::min(size_t(target.tell()), target.size())) != cursorLine;
+}
+
+template<typename TARGET>
+inline bool ConsoleEditor<TARGET>::viewMoved(readonly_target_tag) {
+	return viewMoved(random_access_target_tag { });
+}
+
+template<typename TARGET>
+template<auto METHOD, typename ConsoleEditor<TARGET>::Change CHANGE>
+inline void ConsoleEditor<TARGET>::registerMethod(char key) {
+	static_assert(CHANGE == Change::NONE || isWritableTarget<TARGET>, "This target can not be changed");
+	registerHandler(key, [](ConsoleEditor &editor, std::string_view line) {
+		editor.call(METHOD, line);
+	}, CHANGE);
 }
 
-/**
- * A basic file editor
- */
 template<typename TARGET>
 template<typename RETURN>
-inline void ConsoleEditor<TARGET>::registerMethod(char key, RETURN (TARGET::*method)() const) {
-	commands[key] = [this, method](const std::string&) {
-		std::cout << (target.*method)() << std::endl;
-	};
+inline void ConsoleEditor<TARGET>::call(RETURN (TARGET::*method)() const, std::string_view) {
+	std::cout << (target.*method)() << '\n';
+}
+
+template<typename TARGET>
+inline void ConsoleEditor<TARGET>::call(void (TARGET::*method)(), std::string_view) {
+	(target.*method)();
+}
+
+template<typename TARGET>
+inline void ConsoleEditor<TARGET>::call(void (TARGET::*method)(std::string_view), std::string_view line) {
+	(target.*method)(line.substr(1));
+}
+
+template<typename TARGET>
+template<typename PARAM>
+inline void ConsoleEditor<TARGET>::call(void (TARGET::*method)(PARAM), std::string_view line) {
+	PARAM value;
+	if (!parseNumber(line.substr(1), value)) {
+		std::cerr << "Number expected" << std::endl;
+		return;
+	}
+	(target.*method)(value);
+}
+
+template<typename TARGET>
+inline void ConsoleEditor<TARGET>::call(RangeMethod method, std::string_view line) {
+	(target.*method)(line.data() + 1, line.data() + line.size());
 }
 
 /**
  * A basic file editor
  */
 template<typename TARGET>
-inline void ConsoleEditor<TARGET>::registerMethod(char key, void (TARGET::*method)()) {
-	commands[key] = [this, method](const std::string&) {
-		(target.*method)();
-	};
+inline void ConsoleEditor<TARGET>::initCommands(insertable_target_tag) {
+	initCommands(appendable_target_tag { });
+	registerMethod<static_cast<RangeMethod>(&TARGET::insert), Change::AT_POSITION>('i');
+	registerMethod<&TARGET::erase, Change::AT_POSITION>('d');
+	registerMethod<static_cast<void (TARGET::*)()>(&TARGET::addCursor)>('m');
+	registerMethod<&TARGET::clearCursors>('M');
+	registerMethod<static_cast<RangeMethod>(&TARGET::insertAtCursors), Change::ANYWHERE>('I');
+	registerMethod<&TARGET::eraseAtCursors, Change::ANYWHERE>('D');
+	registerMethod<&TARGET::codepoint>('c');
+	registerMethod<&TARGET::goCodepoints>('u');
+	registerMethod<&TARGET::eraseCodepoints, Change::AT_POSITION>('x');
+	registerHandler('y', [](ConsoleEditor &editor, std::string_view line) {
+		size_t count;
+		if (!parseNumber(line.substr(1), count)) {
+			std::cerr << "Number expected" << std::endl;
+			return;
+		}
+		editor.target.copy(count);
+	});
+	registerHandler('k', [](ConsoleEditor &editor, std::string_view line) {
+		size_t count;
+		if (!parseNumber(line.substr(1), count)) {
+			std::cerr << "Number expected" << std::endl;
+			return;
+		}
+		editor.target.cut(count);
+	}, Change::AT_POSITION);
+	registerHandler('P', [](ConsoleEditor &editor, std::string_view) {
+		editor.target.paste();
+	}, Change::AT_POSITION);
+	registerMethod<&TARGET::stats>('?');
+	registerHandler('G', &ConsoleEditor::goLineCommand);
+	registerHandler('p', [](ConsoleEditor &editor, std::string_view) {
+		size_t line = editor.target.line();
+		editor.target.goLine(line > editor.viewLines ? line - editor.viewLines : 0);
+	});
+	registerHandler('n', [](ConsoleEditor &editor, std::string_view) {
+		editor.target.goLine(editor.target.line() + editor.viewLines);
+	});
 }
 
 /**
  * A basic file editor
  */
 template<typename TARGET>
-inline void ConsoleEditor<TARGET>::registerMethod(char key, void (TARGET::*method)(const std::string&)) {
-	commands[key] = [this, method](const std::string& cmd) {
-		(target.*method)(cmd.substr(1));
-	};
+inline void ConsoleEditor<TARGET>::initCommands(random_access_target_tag) {
+	initCommands(appendable_target_tag { });
+	initBufferPaging();
 }
 
 /**
- * A basic file editor
+ * A basic file viewer
  */
 template<typename TARGET>
-template<typename PARAM>
-inline void ConsoleEditor<TARGET>::registerMethod(char key, void (TARGET::*method)(PARAM)) {
-	commands[key] = [this, method](const std::string& cmd) {
-		std::stringstream ss(cmd.substr(1));
-		PARAM value;
-		ss >> value;
-		if (ss.fail()) {
-			std::cerr << "Number expected" << std::endl;
-		}
-		(target.*method)(value);
-	};
+inline void ConsoleEditor<TARGET>::initCommands(readonly_target_tag) {
+	registerMethod<&TARGET::tell>('t');
+	registerMethod<&TARGET::toStart>('f');
+	registerMethod<&TARGET::toEnd>('l');
+	registerMethod<&TARGET::go>('g');
+	initBufferPaging();
+	registerHandler('G', &ConsoleEditor::goLineCommand);
 }
 
 template<typename TARGET>
-void ConsoleEditor<TARGET>::registerMethod(char key, void (TARGET::*method)(std::string::const_iterator , std::string::const_iterator)){
-	commands[key] = [this, method](const std::string& cmd) {
-		(target.*method)(cmd.begin()+1, cmd.end());
-	};
+inline void ConsoleEditor<TARGET>::goLineCommand(ConsoleEditor &editor, std::string_view line) {
+	size_t number;
+	if (!parseNumber(line.substr(1), number)) {
+		std::cerr << "Number expected" << std::endl;
+		return;
+	}
+	editor.target.goLine(number > 0 ? number - 1 : 0);
 }
 
-/**
- * A basic file editor
- */
 template<typename TARGET>
-inline void ConsoleEditor<TARGET>::initCommands(insertable_target_tag) {
-	initCommands(appendable_target_tag { });
-	registerMethod('i', &TARGET::insert);
-	registerMethod('d', &TARGET::erase);
+inline void ConsoleEditor<TARGET>::initBufferPaging() {
+	registerHandler('p', [](ConsoleEditor &editor, std::string_view) {
+		size_t pos = editor.lineStartOf(std::min(size_t(editor.target.tell()), editor.target.size()));
+		for (size_t i = 0; i < editor.viewLines && pos > 0; ++i) {
+			pos = editor.lineStartOf(pos - 1);
+		}
+		editor.target.toStart();
+		editor.target.go(pos);
+	});
+	registerHandler('n', [](ConsoleEditor &editor, std::string_view) {
+		const char *data = editor.target.data();
+		if (!data) {
+			//Empty files are not mapped.
+			return;
+		}
+		size_t size = editor.target.size(), pos = std::min(size_t(editor.target.tell()), size);
+		for (size_t i = 0; i < editor.viewLines && pos < size; ++i) {
+			auto newline = static_cast<const char*>(memchr(data + pos, '\n', size - pos));
+			if (!newline) {
+				break;
+			}
+			pos = newline - data + 1;
+		}
+		editor.target.toStart();
+		editor.target.go(pos);
+	});
 }
 
 /**
@@ -198,12 +599,12 @@ inline void ConsoleEditor<TARGET>::initCommands(insertable_target_tag) {
  */
 template<typename TARGET>
 inline void ConsoleEditor<TARGET>::initCommands(appendable_target_tag) {
-	registerMethod('t', &TARGET::tell);
-	registerMethod('f', &TARGET::toStart);
-	registerMethod('l', &TARGET::toEnd);
-	registerMethod('g', &TARGET::go);
-	registerMethod('w', &TARGET::replace);
-	registerMethod('s', &TARGET::flush);
+	registerMethod<&TARGET::tell>('t');
+	registerMethod<&TARGET::toStart>('f');
+	registerMethod<&TARGET::toEnd>('l');
+	registerMethod<&TARGET::go>('g');
+	registerMethod<static_cast<RangeMethod>(&TARGET::replace), Change::AT_POSITION>('w');
+	registerMethod<&TARGET::flush>('s');
 }
 
 }  // namespace sweet
@@ -0,0 +1,225 @@
+/**
+ * @file CursorSet.hpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#ifndef SRC_CURSORSET_HPP_
+#define SRC_CURSORSET_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+namespace sweet {
+
+/**
+ * An ordered set of cursor positions.
+ *
+ * The positions are stored as the gaps between consecutive cursors, kept on
+ * a Fenwick tree. Shifting every cursor after a point is then a single gap
+ * update, so an edit costs O(log n) no matter how many cursors there are.
+ * Cursors are kept in order, so the index of a cursor only changes when
+ * cursors are added or removed.
+ */
+class CursorSet {
+public:
+	/**
+	 * @brief The number of cursors
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief true if there are no cursors.
+	 */
+	bool empty() const;
+
+	/**
+	 * @brief The position of the index-th cursor. O(log n).
+	 * @param index
+	 */
+	size_t operator[](size_t index) const;
+
+	/**
+	 * @brief Index of the first cursor at or after pos. O(log n).
+	 * @param pos
+	 * @return the index or size() if there is none.
+	 */
+	size_t lowerBound(size_t pos) const;
+
+	/**
+	 * @brief Adds a cursor. O(n).
+	 * @param pos
+	 */
+	void add(size_t pos);
+
+	/**
+	 * @brief Removes the index-th cursor. O(n).
+	 * @param index
+	 */
+	void remove(size_t index);
+
+	/**
+	 * @brief Removes all cursors.
+	 */
+	void clear();
+
+	/**
+	 * @brief All positions, in order. O(n).
+	 */
+	std::vector<size_t> positions() const;
+
+	/**
+	 * @brief Replaces all positions. O(n).
+	 * @param positions must be sorted.
+	 */
+	void assign(std::vector<size_t> const& positions);
+
+	/**
+	 * @brief Adjusts to an insertion.
+	 *
+	 * Cursors at or after pos are moved count characters forward.
+	 * @param pos
+	 * @param count
+	 */
+	void shift(size_t pos, size_t count);
+
+	/**
+	 * @brief Adjusts to an erasure.
+	 *
+	 * Cursors inside the erased range are moved to pos and the ones after
+	 * it are moved count characters backward.
+	 * @param pos
+	 * @param count
+	 */
+	void collapse(size_t pos, size_t count);
+private:
+	/**
+	 * Adds delta to the index-th gap.
+	 */
+	void addGap(size_t index, ptrdiff_t delta);
+
+	/**
+	 * Sets the position of the index-th cursor, keeping the others.
+	 */
+	void set(size_t index, size_t pos);
+
+private:
+	std::vector<size_t> tree;
+};
+
+inline size_t CursorSet::size() const {
+	return tree.size();
+}
+
+inline bool CursorSet::empty() const {
+	return tree.empty();
+}
+
+inline size_t CursorSet::operator[](size_t index) const {
+	size_t pos = 0;
+	for (size_t i = index + 1; i > 0; i -= i & -i) {
+		pos += tree[i - 1];
+	}
+	return pos;
+}
+
+inline size_t CursorSet::lowerBound(size_t pos) const {
+	size_t mask = 1;
+	while (mask <= tree.size()) {
+		mask <<= 1;
+	}
+	size_t index = 0, sum = 0;
+	for (; mask > 0; mask >>= 1) {
+		size_t next = index + mask;
+		if (next <= tree.size() && sum + tree[next - 1] < pos) {
+			index = next;
+			sum += tree[next - 1];
+		}
+	}
+	return index;
+}
+
+inline void CursorSet::add(size_t pos) {
+	auto current = positions();
+	current.insert(std::upper_bound(current.begin(), current.end(), pos), pos);
+	assign(current);
+}
+
+inline void CursorSet::remove(size_t index) {
+	auto current = positions();
+	current.erase(current.begin() + index);
+	assign(current);
+}
+
+inline void CursorSet::clear() {
+	tree.clear();
+}
+
+inline std::vector<size_t> CursorSet::positions() const {
+	//Undo the Fenwick construction to get the gaps back, then sum them up.
+	std::vector<size_t> result(tree);
+	for (size_t i = result.size(); i > 0; --i) {
+		size_t parent = i + (i & -i);
+		if (parent <= result.size()) {
+			result[parent - 1] -= result[i - 1];
+		}
+	}
+	for (size_t i = 1; i < result.size(); ++i) {
+		result[i] += result[i - 1];
+	}
+	return result;
+}
+
+inline void CursorSet::assign(std::vector<size_t> const& positions) {
+	tree.resize(positions.size());
+	size_t previous = 0;
+	for (size_t i = 0; i < positions.size(); ++i) {
+		tree[i] = positions[i] - previous;
+		previous = positions[i];
+	}
+	//Linear Fenwick construction
+	for (size_t i = 1; i <= tree.size(); ++i) {
+		size_t parent = i + (i & -i);
+		if (parent <= tree.size()) {
+			tree[parent - 1] += tree[i - 1];
+		}
+	}
+}
+
+inline void CursorSet::shift(size_t pos, size_t count) {
+	size_t index = lowerBound(pos);
+	if (index < tree.size()) {
+		addGap(index, count);
+	}
+}
+
+inline void CursorSet::collapse(size_t pos, size_t count) {
+	size_t first = lowerBound(pos + 1);
+	size_t last = lowerBound(pos + count);
+	if (last < tree.size()) {
+		addGap(last, -ptrdiff_t(count));
+	}
+	for (size_t i = first; i < last; ++i) {
+		set(i, pos);
+	}
+}
+
+inline void CursorSet::addGap(size_t index, ptrdiff_t delta) {
+	for (size_t i = index + 1; i <= tree.size(); i += i & -i) {
+		tree[i - 1] += delta;
+	}
+}
+
+inline void CursorSet::set(size_t index, size_t pos) {
+	ptrdiff_t delta = pos - (*this)[index];
+	addGap(index, delta);
+	if (index + 1 < tree.size()) {
+		addGap(index + 1, -delta);
+	}
+}
+
+}  // namespace sweet
+
+#endif /* SRC_CURSORSET_HPP_ */
@@ -0,0 +1,131 @@
+/**
+ * @file FileCopy.hpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#ifndef SRC_FILECOPY_HPP_
+#define SRC_FILECOPY_HPP_
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sweet {
+
+/**
+ * @brief Writes count characters at pos of a file descriptor.
+ */
+inline void writeFileRange(int out, size_t pos, const char *data, size_t count) {
+	while (count > 0) {
+		ssize_t written = pwrite(out, data, count, pos);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			throw std::runtime_error(std::string("Error writing: ") + std::strerror(errno));
+		}
+		data += written;
+		pos += written;
+		count -= written;
+	}
+}
+
+/**
+ * @brief Copies count characters between file descriptors, through a buffer.
+ *
+ * The ranges may be on the same file and overlap; the blocks are copied
+ * in the order that does not overwrite what is still to be read.
+ * @return how many characters were copied, less than count if the input ended.
+ */
+inline size_t bufferedCopyFileRange(int in, size_t inPos, int out, size_t outPos, size_t count) {
+	constexpr size_t BLOCK_SIZE = 1024 * 1024;
+	std::unique_ptr<char[]> buffer(new char[std::min(count, BLOCK_SIZE)]);
+	bool backwards = in == out && outPos > inPos;
+	for (size_t done = 0; done < count;) {
+		size_t length = std::min(count - done, BLOCK_SIZE);
+		size_t offset = backwards ? count - done - length : done;
+		size_t total = 0;
+		while (total < length) {
+			ssize_t read = pread(in, buffer.get() + total, length - total, inPos + offset + total);
+			if (read < 0 && errno == EINTR) {
+				continue;
+			} else if (read < 0) {
+				throw std::runtime_error(std::string("Error reading: ") + std::strerror(errno));
+			} else if (read == 0) {
+				break;
+			}
+			total += read;
+		}
+		writeFileRange(out, outPos + offset, buffer.get(), total);
+		if (total < length) {
+			return done + total;
+		}
+		done += length;
+	}
+	return count;
+}
+
+/**
+ * @brief Copies count characters between file descriptors, on the kernel if it can.
+ *
+ * Uses copy_file_range, so the content does not go through user space,
+ * and falls back to bufferedCopyFileRange() where it is not supported.
+ * The ranges may be on the same file and overlap. Then the kernel copies
+ * only blocks that do not overlap, so close ranges are buffered.
+ * @return how many characters were copied, less than count if the input ended.
+ */
+inline size_t copyFileRange(int in, size_t inPos, int out, size_t outPos, size_t count) {
+#ifdef __linux__
+	constexpr size_t MIN_BLOCK = 64 * 1024, MAX_BLOCK = 64 * 1024 * 1024;
+	size_t block = MAX_BLOCK;
+	bool backwards = false;
+	if (in == out) {
+		size_t distance = inPos < outPos ? outPos - inPos : inPos - outPos;
+		block = std::min(block, distance);
+		backwards = outPos > inPos;
+	}
+	if (block >= MIN_BLOCK) {
+		for (size_t done = 0; done < count;) {
+			size_t length = std::min(count - done, block);
+			size_t offset = backwards ? count - done - length : done;
+			loff_t from = inPos + offset, to = outPos + offset;
+			ssize_t copied = copy_file_range(in, &from, out, &to, length, 0);
+			if (copied < 0 && errno == EINTR) {
+				continue;
+			} else if (copied < 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP)) {
+				//Not supported here, so the rest is buffered.
+				size_t rest = count - done;
+				size_t restIn = backwards ? inPos : inPos + done, restOut = backwards ? outPos : outPos + done;
+				return done + bufferedCopyFileRange(in, restIn, out, restOut, rest);
+			} else if (copied < 0) {
+				throw std::runtime_error(std::string("Error copying: ") + std::strerror(errno));
+			} else if (copied == 0) {
+				return done;
+			}
+			if (size_t(copied) < length && backwards) {
+				//Copies the tail left from this block before going on.
+				done += copied;
+				size_t left = length - copied;
+				done += bufferedCopyFileRange(in, inPos + offset + copied, out, outPos + offset + copied, left);
+				continue;
+			}
+			done += copied;
+		}
+		return count;
+	}
+#endif
+	return bufferedCopyFileRange(in, inPos, out, outPos, count);
+}
+
+}  // namespace sweet
+
+#endif /* SRC_FILECOPY_HPP_ */
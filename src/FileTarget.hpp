@@ -8,11 +8,13 @@
 #ifndef SWEET_FILETARGET_HPP_
 #define SWEET_FILETARGET_HPP_
 
+#include <atomic>
 #include <cerrno>
 #include <cstring>
 #include <cstdio>
 #include <stdexcept>
 #include <string>
+#include <unistd.h>
 #include "TargetTraits.hpp"
 
 namespace sweet {
@@ -53,6 +55,18 @@ public:
 	template<typename OUTPUT_ITERATOR>
 	void viewRange(long pos, long count, OUTPUT_ITERATOR &&out) const;
 
+	/**
+	 * @brief Copies a range into a buffer, in bulk.
+	 *
+	 * It does not move the position and can be called from several
+	 * threads at once. Pending writes must be flushed first.
+	 * @param pos
+	 * @param count
+	 * @param buffer must have space for count characters.
+	 * @return the number of characters read.
+	 */
+	size_t readRange(long pos, long count, char *buffer) const;
+
 	/**
 	 * @brief  Return our current position
 	 */
@@ -87,18 +101,53 @@ public:
 
 	void shrink();
 
+	/**
+	 * @brief The file descriptor, for system calls. Pending writes must be flushed first.
+	 */
+	int descriptor() const;
+
+	/**
+	 * @brief Closes the file and opens another, as one renamed over it.
+	 *
+	 * The position goes to the start; the read counters go on.
+	 * @param filename
+	 */
+	void reopen(std::string const& filename);
+
+	/**
+	 * @brief How many times readRange() read, each a positioned read.
+	 */
+	size_t reads() const;
+
+	/**
+	 * @brief How many characters readRange() read.
+	 */
+	size_t bytesRead() const;
+
 private:
+	/**
+	 * Opens the file, creating it if it does not exist.
+	 */
+	static FILE *open(std::string const& filename);
+
 	FILE *file;
+	/// Atomic, as readRange() is called from several threads.
+	mutable std::atomic<size_t> reads_ { 0 }, bytesRead_ { 0 };
 };
 
-inline FileTarget::FileTarget(std::string const& filename) {
-	file = fopen(filename.c_str(), "rb+");
+inline FileTarget::FileTarget(std::string const& filename) :
+		file(open(filename)) {
+}
+
+inline FILE *FileTarget::open(std::string const& filename) {
+	FILE *file = fopen(filename.c_str(), "rb+");
 	if (!file) { //Maybe it does not exist, so we try to create a new
 		file = fopen(filename.c_str(), "wb+");
 		if (!file) { //If it still doesn't exist, we quit.
 			throw std::runtime_error("Error opening '" + filename + "': " + std::strerror(errno));
 		}
 	}
+	return file;
 }
 
 inline FileTarget::~FileTarget() {
@@ -122,6 +171,20 @@ inline void FileTarget::viewRange(long pos, long count, OUTPUT_ITERATOR &&out) c
 	}
 }
 
+inline size_t FileTarget::readRange(long pos, long count, char* buffer) const {
+	size_t total = 0;
+	while (total < size_t(count)) {
+		ssize_t read = pread(fileno(file), buffer + total, count - total, pos + total);
+		if (read <= 0) {
+			break;
+		}
+		total += read;
+	}
+	reads_.fetch_add(1, std::memory_order_relaxed);
+	bytesRead_.fetch_add(total, std::memory_order_relaxed);
+	return total;
+}
+
 inline long FileTarget::tell() const {
 	return ftell(file);
 }
@@ -157,14 +220,28 @@ inline void FileTarget::flush() {
 }
 
 inline void FileTarget::shrink() {
-	auto pos = tell();
-	toStart();
-	std::string content;
-	view(pos, std::back_inserter(content));
-	if(!freopen(nullptr, "w+", file)){
-		throw new std::runtime_error("Can not shrink");
+	fflush(file);
+	if (ftruncate(fileno(file), tell()) < 0) {
+		throw std::runtime_error(std::string("Can not shrink: ") + std::strerror(errno));
 	}
-	replace(content.begin(), content.end());
+}
+
+inline int FileTarget::descriptor() const {
+	return fileno(file);
+}
+
+inline void FileTarget::reopen(std::string const& filename) {
+	FILE *opened = open(filename);
+	fclose(file);
+	file = opened;
+}
+
+inline size_t FileTarget::reads() const {
+	return reads_.load(std::memory_order_relaxed);
+}
+
+inline size_t FileTarget::bytesRead() const {
+	return bytesRead_.load(std::memory_order_relaxed);
 }
 
 }
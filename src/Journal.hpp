@@ -0,0 +1,388 @@
+/**
+ * @file Journal.hpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#ifndef SRC_JOURNAL_HPP_
+#define SRC_JOURNAL_HPP_
+
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sweet {
+
+/**
+ * An append only log of the edits not yet flushed to a target file.
+ *
+ * The edits are recorded in a buffer and written together on commit(), so
+ * a command that makes many edits costs a single write. If the process dies
+ * the journal is replayed on the next open. How often it is synced to the
+ * disc, which protects it from a system crash too, is configurable.
+ *
+ * The journal header identifies the target by its size and modification
+ * time, so a journal left behind by a target changed since is discarded.
+ * Every record has a checksum, and a torn one ends the replay.
+ */
+class Journal {
+public:
+	/**
+	 * When the journal is synced to the disc.
+	 */
+	enum class Sync {
+		EACH,     ///< On every commit.
+		PERIODIC, ///< On a commit at least a period after the last sync.
+		NEVER,    ///< Never, only written.
+	};
+
+	/**
+	 * The recorded operations.
+	 */
+	enum class Operation : uint8_t {
+		INSERT = 1,  ///< Inserts the content at pos.
+		ERASE,       ///< Erases count characters at pos.
+		REPLACE,     ///< Overwrites with the content at pos.
+		INSERT_FILE, ///< Inserts a range of another file at pos. See insertFile().
+		MOVE,        ///< Moves a range from pos to another place. See move().
+	};
+
+	/**
+	 * What tells a file changed: its size and modification time.
+	 */
+	struct Stamp {
+		uint64_t size;
+		int64_t modified; ///< in nanoseconds.
+
+		bool operator==(Stamp const& other) const {
+			return size == other.size && modified == other.modified;
+		}
+	};
+
+	/**
+	 * @brief The stamp of a file, as fstat() or stat() told it.
+	 */
+	static Stamp stamp(struct stat const& status);
+
+	/**
+	 * @brief Opens the journal of a target, creating it if needed.
+	 * @param filename the journal file.
+	 * @param target the target file.
+	 * @param sync
+	 * @param period the minimum interval between syncs, if sync is PERIODIC.
+	 */
+	Journal(std::string const& filename, std::string const& target, Sync sync = Sync::PERIODIC,
+			std::chrono::milliseconds period = std::chrono::milliseconds(1000));
+
+	/**
+	 * Dtor. Commits and syncs what is pending.
+	 */
+	~Journal();
+
+	//We cant have these.
+	Journal(Journal const&) = delete;
+	Journal &operator=(Journal const&) = delete;
+
+	/**
+	 * @brief Calls fn(operation, pos, count, content) for every valid record.
+	 *
+	 * The content is only meaningful for inserts and replaces, and is not
+	 * valid after fn returns. A torn tail is cut, so the next records are
+	 * appended after the last valid one.
+	 */
+	template<typename FUNCTION>
+	void replay(FUNCTION &&fn);
+
+	/**
+	 * @brief Records an insertion.
+	 */
+	template<typename FORWARD_ITERATOR>
+	void insert(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last);
+
+	/**
+	 * @brief Records an insertion of a file range, by reference.
+	 *
+	 * Its content is the offset, the length and the source stamp, as four
+	 * 64 bit integers, followed by the path. The path must be absolute, as
+	 * the journal may be replayed from another directory, and the stamp
+	 * lets the replay tell whether the source changed since.
+	 */
+	void insertFile(size_t pos, std::string const& path, size_t offset, size_t length, Stamp source);
+
+	/**
+	 * @brief Records a move of count characters from pos to destination.
+	 *
+	 * Its content is the count and the destination, as two uint64_t.
+	 */
+	void move(size_t pos, size_t count, size_t destination);
+
+	/**
+	 * @brief Records an erasure.
+	 */
+	void erase(size_t pos, size_t count);
+
+	/**
+	 * @brief Records a replacement.
+	 */
+	template<typename FORWARD_ITERATOR>
+	void replace(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last);
+
+	/**
+	 * @brief Writes the pending records and syncs them as the policy says.
+	 */
+	void commit();
+
+	/**
+	 * @brief Drops all records, as the target now has them.
+	 *
+	 * The journal is bound to the target as it is now.
+	 */
+	void reset();
+private:
+	struct Header {
+		char magic[4];
+		uint32_t version;
+		uint64_t size;
+		int64_t modified;
+	};
+
+	template<typename FORWARD_ITERATOR>
+	void record(Operation operation, size_t pos, size_t count, FORWARD_ITERATOR first, FORWARD_ITERATOR last);
+
+	/**
+	 * The header of the target as it is now.
+	 */
+	Header identify() const;
+
+	void write(const char *data, size_t count);
+
+	void sync();
+
+	/**
+	 * FNV-1a, continuing from hash.
+	 */
+	static uint32_t checksum(const char *data, size_t count, uint32_t hash = 2166136261u);
+
+	[[noreturn]] void fail(std::string const& what) const;
+
+	static constexpr uint32_t VERSION = 2;
+	/// Operation, pos and count.
+	static constexpr size_t RECORD_HEAD = 1 + 2 * sizeof(uint64_t);
+
+private:
+	std::string filename, target;
+	Sync sync_;
+	std::chrono::milliseconds period;
+	std::chrono::steady_clock::time_point lastSync;
+	int fd;
+	/// Records not yet written.
+	std::string pending;
+	/// Records written but not synced.
+	bool unsynced = false;
+	/// If the header matches the target, so the records can be replayed.
+	bool matches = false;
+};
+
+inline Journal::Journal(std::string const& filename, std::string const& target, Sync sync,
+		std::chrono::milliseconds period) :
+		filename(filename), target(target), sync_(sync), period(period), lastSync(std::chrono::steady_clock::now()) {
+	fd = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		fail("Error opening");
+	}
+	Header header, current = identify();
+	matches = pread(fd, &header, sizeof(header), 0) == ssize_t(sizeof(header))
+			&& memcmp(&header, &current, sizeof(header)) == 0;
+	try {
+		if (!matches) {
+			reset();
+		} else if (lseek(fd, 0, SEEK_END) < 0) {
+			fail("Error seeking");
+		}
+	} catch (...) {
+		close(fd);
+		throw;
+	}
+}
+
+inline Journal::~Journal() {
+	try {
+		commit();
+		if (unsynced && sync_ != Sync::NEVER) {
+			sync();
+		}
+	} catch (...) {
+		//Nothing more can be done here.
+	}
+	close(fd);
+}
+
+template<typename FUNCTION>
+inline void Journal::replay(FUNCTION &&fn) {
+	off_t offset = sizeof(Header);
+	struct stat status;
+	if (matches && fstat(fd, &status) == 0) {
+		std::string content;
+		char head[RECORD_HEAD];
+		while (pread(fd, head, RECORD_HEAD, offset) == ssize_t(RECORD_HEAD)) {
+			Operation operation = Operation(head[0]);
+			if (operation < Operation::INSERT || operation > Operation::MOVE) {
+				break;
+			}
+			uint64_t pos, count;
+			memcpy(&pos, head + 1, sizeof(pos));
+			memcpy(&count, head + 1 + sizeof(pos), sizeof(count));
+			size_t length = operation == Operation::ERASE ? 0 : count;
+			//A torn count could be anything.
+			if (length > size_t(status.st_size - offset)) {
+				break;
+			}
+			content.resize(length + sizeof(uint32_t));
+			if (pread(fd, &content[0], content.size(), offset + RECORD_HEAD) != ssize_t(content.size())) {
+				break;
+			}
+			uint32_t stored;
+			memcpy(&stored, content.data() + length, sizeof(stored));
+			if (stored != checksum(content.data(), length, checksum(head, RECORD_HEAD))) {
+				break;
+			}
+			fn(operation, size_t(pos), size_t(count), content.data());
+			offset += RECORD_HEAD + content.size();
+		}
+	}
+	if (ftruncate(fd, offset) < 0 || lseek(fd, offset, SEEK_SET) < 0) {
+		fail("Error truncating");
+	}
+	matches = true;
+}
+
+template<typename FORWARD_ITERATOR>
+inline void Journal::insert(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
+	record(Operation::INSERT, pos, std::distance(first, last), first, last);
+}
+
+inline void Journal::insertFile(size_t pos, std::string const& path, size_t offset, size_t length, Stamp source) {
+	uint64_t values[4] = { offset, length, source.size, uint64_t(source.modified) };
+	std::string content(reinterpret_cast<const char*>(values), sizeof(values));
+	content += path;
+	record(Operation::INSERT_FILE, pos, content.size(), content.begin(), content.end());
+}
+
+inline void Journal::move(size_t pos, size_t count, size_t destination) {
+	uint64_t values[2] = { count, destination };
+	std::string content(reinterpret_cast<const char*>(values), sizeof(values));
+	record(Operation::MOVE, pos, content.size(), content.begin(), content.end());
+}
+
+inline void Journal::erase(size_t pos, size_t count) {
+	const char *none = nullptr;
+	record(Operation::ERASE, pos, count, none, none);
+}
+
+template<typename FORWARD_ITERATOR>
+inline void Journal::replace(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
+	record(Operation::REPLACE, pos, std::distance(first, last), first, last);
+}
+
+inline void Journal::commit() {
+	if (!pending.empty()) {
+		write(pending.data(), pending.size());
+		pending.clear();
+		unsynced = true;
+	}
+	if (!unsynced) {
+		return;
+	}
+	if (sync_ == Sync::EACH || (sync_ == Sync::PERIODIC && std::chrono::steady_clock::now() - lastSync >= period)) {
+		sync();
+	}
+}
+
+inline void Journal::reset() {
+	pending.clear();
+	Header header = identify();
+	if (ftruncate(fd, 0) < 0 || lseek(fd, 0, SEEK_SET) < 0) {
+		fail("Error truncating");
+	}
+	write(reinterpret_cast<const char*>(&header), sizeof(header));
+	sync();
+	matches = true;
+}
+
+template<typename FORWARD_ITERATOR>
+inline void Journal::record(Operation operation, size_t pos, size_t count, FORWARD_ITERATOR first,
+		FORWARD_ITERATOR last) {
+	size_t start = pending.size();
+	uint64_t values[2] = { pos, count };
+	pending += char(operation);
+	pending.append(reinterpret_cast<const char*>(values), sizeof(values));
+	pending.append(first, last);
+	uint32_t sum = checksum(pending.data() + start, pending.size() - start);
+	pending.append(reinterpret_cast<const char*>(&sum), sizeof(sum));
+}
+
+inline Journal::Header Journal::identify() const {
+	struct stat status;
+	if (stat(target.c_str(), &status) < 0) {
+		fail("Error reading the target of");
+	}
+	Header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "SWJ", 4);
+	header.version = VERSION;
+	Stamp current = stamp(status);
+	header.size = current.size;
+	header.modified = current.modified;
+	return header;
+}
+
+inline Journal::Stamp Journal::stamp(struct stat const& status) {
+	return Stamp { uint64_t(status.st_size), int64_t(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec };
+}
+
+inline void Journal::write(const char* data, size_t count) {
+	while (count > 0) {
+		ssize_t written = ::write(fd, data, count);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fail("Error writing");
+		}
+		data += written;
+		count -= written;
+	}
+}
+
+inline void Journal::sync() {
+	if (fdatasync(fd) < 0) {
+		fail("Error syncing");
+	}
+	lastSync = std::chrono::steady_clock::now();
+	unsynced = false;
+}
+
+inline uint32_t Journal::checksum(const char* data, size_t count, uint32_t hash) {
+	for (size_t i = 0; i < count; ++i) {
+		hash = (hash ^ static_cast<unsigned char>(data[i])) * 16777619u;
+	}
+	return hash;
+}
+
+inline void Journal::fail(std::string const& what) const {
+	throw std::runtime_error(what + " '" + filename + "': " + std::strerror(errno));
+}
+
+}  // namespace sweet
+
+#endif /* SRC_JOURNAL_HPP_ */
@@ -0,0 +1,602 @@
+/**
+ * @file LineIndex.hpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#ifndef SRC_LINEINDEX_HPP_
+#define SRC_LINEINDEX_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "FileTarget.hpp"
+#include "Utf8.hpp"
+
+namespace sweet {
+
+/**
+ * The newlines and UTF-8 codepoints of a file.
+ *
+ * It lets the original content answer how many lines a range has and where
+ * a line starts in O(log n), reading at most a checkpoint of the file.
+ *
+ * Only counts are kept: the newlines and continuation bytes before every
+ * checkpoint of 1KB, as 32 bit counts from their block start. A query finds
+ * the checkpoint and scans the content from there, so the index takes about
+ * 1/250 of the file. A block without continuation bytes has no checkpoints
+ * for them at all. The last scans are cached, as the edits ask for the same
+ * leaf borders again, so queries must come from one thread at a time.
+ *
+ * The file is split in blocks, indexed in parallel, one thread per core.
+ * The per block counts are merged into prefix sums as soon as all blocks
+ * before are done, so the beginning of the file can be queried while the
+ * rest is still being indexed. Queries past the published blocks wait.
+ */
+class LineIndex {
+public:
+	static constexpr size_t npos = size_t(-1);
+
+	/**
+	 * @brief Scans the file and indexes all its newlines.
+	 * @param file must be valid and unchanged while the index is queried.
+	 * @param size the file size.
+	 */
+	void build(const FileTarget& file, size_t size);
+
+	/**
+	 * @brief Indexes a content already in memory.
+	 * @param data must be valid and unchanged while the index is queried.
+	 * @param size
+	 */
+	void build(const char *data, size_t size);
+
+	/**
+	 * @brief Indexes a content already in memory on the background.
+	 *
+	 * The index can be queried as soon as this returns.
+	 * @param data must be valid and unchanged while the index is queried.
+	 * @param size
+	 * @param stop when set the build is abandoned. Queries on what was not
+	 * indexed then answer as if there was nothing there.
+	 * @return the thread building the index, to be joined.
+	 */
+	std::thread buildAsync(const char *data, size_t size, const std::atomic<bool> *stop);
+
+	/**
+	 * @brief Indexes a file on the background.
+	 *
+	 * The index can be queried as soon as this returns.
+	 * @param file must be valid and unchanged while the index is queried.
+	 * @param size the file size.
+	 * @param stop when set the build is abandoned.
+	 * @return the thread building the index, to be joined.
+	 */
+	std::thread buildAsync(const FileTarget& file, size_t size, const std::atomic<bool> *stop);
+
+	/**
+	 * @brief Tells if the whole content is indexed.
+	 */
+	bool complete() const;
+
+	/**
+	 * @brief Counts the newlines on [first, last).
+	 * @param first
+	 * @param last
+	 */
+	size_t count(size_t first, size_t last) const;
+
+	/**
+	 * @brief Counts the newlines and codepoints on [first, last), reading
+	 * each end once.
+	 * @param first
+	 * @param last
+	 * @return the newlines and the codepoints.
+	 */
+	std::pair<size_t, size_t> counts(size_t first, size_t last) const;
+
+	/**
+	 * @brief Finds the nth newline on [first, last).
+	 * @param first
+	 * @param last
+	 * @param nth zero based
+	 * @return its position or npos if the range has not enough newlines.
+	 */
+	size_t find(size_t first, size_t last, size_t nth) const;
+
+	/**
+	 * @brief Counts the codepoints starting on [first, last).
+	 * @param first
+	 * @param last
+	 */
+	size_t codepoints(size_t first, size_t last) const;
+
+	/**
+	 * @brief Finds where the nth codepoint on [first, last) starts.
+	 * @param first
+	 * @param last
+	 * @param nth zero based
+	 * @return its position or npos if the range has not enough codepoints.
+	 */
+	size_t findCodepoint(size_t first, size_t last, size_t nth) const;
+
+	/**
+	 * @brief Tells if the whole file is valid UTF-8.
+	 */
+	bool utf8() const;
+
+	/**
+	 * @brief Detects the encoding of the whole file.
+	 */
+	Encoding encoding() const;
+private:
+	/// Reads [first, first + count) to buffer, returning where the content is.
+	using Reader = std::function<const char*(size_t first, size_t count, char *buffer)>;
+
+	/**
+	 * The index of a block.
+	 */
+	struct Block {
+		/// Newlines before every checkpoint, the block total included.
+		std::vector<uint32_t> newlines;
+		/// Continuation bytes before every checkpoint, empty if there are none.
+		std::vector<uint32_t> continuations;
+		bool valid = true;
+		bool done = false;
+	};
+
+	/**
+	 * A position scanned by before().
+	 */
+	struct Scanned {
+		size_t pos = npos;
+		std::pair<size_t, size_t> before;
+	};
+
+	/**
+	 * Sets up the blocks for a content of size.
+	 * @param reader kept to scan the checkpoints on queries.
+	 */
+	void reset(size_t size, Reader reader);
+
+	/**
+	 * Reads through the file, filling what is past its end with zeros.
+	 */
+	static auto fileReader(const FileTarget& file);
+
+	/**
+	 * Starts indexing all blocks on a new thread.
+	 */
+	template<typename READ>
+	std::thread scanAsync(READ read, size_t size, const std::atomic<bool> *stop);
+
+	/**
+	 * Indexes all blocks, with a thread per core.
+	 * @param read read(first, count, buffer) returns a pointer to the content
+	 * on [first, first + count), copying it to buffer if needed.
+	 * @param stop
+	 */
+	template<typename READ>
+	void scanAll(READ read, const std::atomic<bool> *stop);
+
+	/**
+	 * Indexes a block. The data goes up to 3 bytes around it, as UTF-8
+	 * sequences may cross the block borders.
+	 * @param index the block
+	 * @param data the content on [readFirst, readLast)
+	 * @param readFirst
+	 * @param readLast
+	 */
+	void scan(size_t index, const char *data, size_t readFirst, size_t readLast);
+
+	/**
+	 * Marks a block done and publishes all done blocks in sequence.
+	 */
+	void publish(size_t index);
+
+	/**
+	 * Gives up on the blocks not done, so nothing waits for them.
+	 */
+	void abandon();
+
+	/**
+	 * Waits until count blocks are published.
+	 */
+	void waitFor(size_t count) const;
+
+	/**
+	 * Waits until the block containing pos is published and returns it.
+	 */
+	size_t blockOf(size_t pos) const;
+
+	/**
+	 * The newlines and continuation bytes before pos.
+	 */
+	std::pair<size_t, size_t> before(size_t pos) const;
+
+	/**
+	 * The newlines before pos.
+	 */
+	size_t newlinesBefore(size_t pos) const;
+
+	/**
+	 * The continuation bytes before pos.
+	 */
+	size_t continuations(size_t pos) const;
+
+	/**
+	 * The content of the checkpoint of a published block, up to its end.
+	 * @param index the block.
+	 * @param checkpoint within the block.
+	 * @param buffer room for a checkpoint, if it must be copied.
+	 * @param length receives its length.
+	 */
+	const char *readCheckpoint(size_t index, size_t checkpoint, char *buffer, size_t &length) const;
+
+	static constexpr size_t BLOCK_SIZE = 1024 * 1024;
+	/// The content scanned on queries, at most.
+	static constexpr size_t CHECKPOINT_SIZE = 1024;
+	/// How much of a neighbor block a sequence may use.
+	static constexpr size_t SEQUENCE_MARGIN = 3;
+
+private:
+	size_t size = 0;
+	Reader reader;
+	std::vector<Block> blocks;
+	/// The newlines and continuations before each block, one more than blocks.
+	std::vector<size_t> newlinesPrefix, continuationsPrefix;
+	bool valid = true;
+	/// The last positions scanned, replaced in turn.
+	mutable std::array<Scanned, 4> scanned;
+	mutable size_t nextScanned = 0;
+
+	std::atomic<size_t> published { 0 };
+	std::atomic<bool> abandoned { false };
+	mutable std::mutex mutex;
+	mutable std::condition_variable progress;
+};
+
+inline auto LineIndex::fileReader(const FileTarget& file) {
+	return [&file](size_t first, size_t count, char *buffer) {
+		size_t read = file.readRange(first, count, buffer);
+		std::fill(buffer + read, buffer + count, '\0');
+		return (const char *) buffer;
+	};
+}
+
+inline void LineIndex::build(const FileTarget& file, size_t size) {
+	reset(size, fileReader(file));
+	scanAll(fileReader(file), nullptr);
+}
+
+inline void LineIndex::build(const char* data, size_t size) {
+	auto read = [data](size_t first, size_t, char*) {
+		return data + first;
+	};
+	reset(size, read);
+	scanAll(read, nullptr);
+}
+
+inline std::thread LineIndex::buildAsync(const char* data, size_t size, const std::atomic<bool> *stop) {
+	return scanAsync([data](size_t first, size_t, char*) {
+		return data + first;
+	}, size, stop);
+}
+
+inline std::thread LineIndex::buildAsync(const FileTarget& file, size_t size, const std::atomic<bool> *stop) {
+	return scanAsync(fileReader(file), size, stop);
+}
+
+inline bool LineIndex::complete() const {
+	return published.load(std::memory_order_acquire) == blocks.size();
+}
+
+inline size_t LineIndex::count(size_t first, size_t last) const {
+	if (first >= last) {
+		return 0;
+	}
+	return newlinesBefore(last) - newlinesBefore(first);
+}
+
+inline std::pair<size_t, size_t> LineIndex::counts(size_t first, size_t last) const {
+	if (first >= last) {
+		return {0, 0};
+	}
+	auto head = before(first), tail = before(last);
+	return {tail.first - head.first, last - first - (tail.second - head.second)};
+}
+
+inline size_t LineIndex::find(size_t first, size_t last, size_t nth) const {
+	if (blocks.empty()) {
+		return npos;
+	}
+	size_t wanted = newlinesBefore(first) + nth;
+	//Wait for blocks until one has the wanted newline or the range ends.
+	size_t index = blockOf(first), lastBlock = std::min(last / BLOCK_SIZE, blocks.size() - 1);
+	for (; index <= lastBlock; ++index) {
+		waitFor(index + 1);
+		if (newlinesPrefix[index + 1] > wanted) {
+			break;
+		}
+	}
+	if (index > lastBlock || index >= published.load(std::memory_order_acquire)) {
+		return npos;
+	}
+	auto const& newlines = blocks[index].newlines;
+	size_t remaining = wanted - newlinesPrefix[index];
+	//The last checkpoint not after it.
+	size_t checkpoint = std::upper_bound(newlines.begin(), newlines.end(), remaining) - newlines.begin() - 1;
+	remaining -= newlines[checkpoint];
+	char buffer[CHECKPOINT_SIZE];
+	size_t length;
+	const char *data = readCheckpoint(index, checkpoint, buffer, length), *it = data;
+	for (; (it = static_cast<const char*>(memchr(it, '\n', data + length - it))) && remaining > 0; ++it) {
+		--remaining;
+	}
+	if (!it) {
+		return npos;
+	}
+	size_t pos = index * BLOCK_SIZE + checkpoint * CHECKPOINT_SIZE + (it - data);
+	return pos < last ? pos : npos;
+}
+
+inline size_t LineIndex::codepoints(size_t first, size_t last) const {
+	if (first >= last) {
+		return 0;
+	}
+	return last - first - (continuations(last) - continuations(first));
+}
+
+inline size_t LineIndex::findCodepoint(size_t first, size_t last, size_t nth) const {
+	if (blocks.empty()) {
+		return npos;
+	}
+	//The codepoints before the wanted one, counting from the file start.
+	size_t wanted = first - continuations(first) + nth;
+	size_t index = blockOf(first), lastBlock = std::min(last / BLOCK_SIZE, blocks.size() - 1);
+	for (; index < lastBlock; ++index) {
+		waitFor(index + 1);
+		if ((index + 1) * BLOCK_SIZE - continuationsPrefix[index + 1] > wanted) {
+			break;
+		}
+	}
+	waitFor(index + 1);
+	if (index >= published.load(std::memory_order_acquire)) {
+		return npos;
+	}
+	Block const& block = blocks[index];
+	size_t blockFirst = index * BLOCK_SIZE;
+	size_t remaining = wanted - (blockFirst - continuationsPrefix[index]);
+	size_t pos = npos;
+	if (block.continuations.empty()) {
+		pos = blockFirst + remaining;
+	} else {
+		//The last checkpoint not starting after it.
+		size_t checkpoint = 0, high = block.continuations.size() - 1;
+		while (high - checkpoint > 1) {
+			size_t middle = (checkpoint + high) / 2;
+			if (middle * CHECKPOINT_SIZE - block.continuations[middle] <= remaining) {
+				checkpoint = middle;
+			} else {
+				high = middle;
+			}
+		}
+		remaining -= checkpoint * CHECKPOINT_SIZE - block.continuations[checkpoint];
+		char buffer[CHECKPOINT_SIZE];
+		size_t length;
+		const char *data = readCheckpoint(index, checkpoint, buffer, length);
+		for (size_t i = 0; i < length; ++i) {
+			if (isContinuation(data[i])) {
+				continue;
+			}
+			if (remaining == 0) {
+				pos = blockFirst + checkpoint * CHECKPOINT_SIZE + i;
+				break;
+			}
+			--remaining;
+		}
+	}
+	return pos < std::min(last, std::min(blockFirst + BLOCK_SIZE, size)) ? pos : npos;
+}
+
+inline bool LineIndex::utf8() const {
+	waitFor(blocks.size());
+	return valid;
+}
+
+inline Encoding LineIndex::encoding() const {
+	waitFor(blocks.size());
+	if (!valid) {
+		return Encoding::UNKNOWN;
+	}
+	//Valid UTF-8 without any multibyte sequence.
+	return continuationsPrefix[published.load(std::memory_order_acquire)] == 0 ? Encoding::ASCII : Encoding::UTF8;
+}
+
+inline void LineIndex::reset(size_t size, Reader reader) {
+	this->size = size;
+	this->reader = std::move(reader);
+	scanned.fill(Scanned { });
+	blocks.clear();
+	blocks.resize((size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+	newlinesPrefix.assign(blocks.size() + 1, 0);
+	continuationsPrefix.assign(blocks.size() + 1, 0);
+	valid = true;
+	published = 0;
+	abandoned = false;
+}
+
+template<typename READ>
+inline std::thread LineIndex::scanAsync(READ read, size_t size, const std::atomic<bool> *stop) {
+	reset(size, read);
+	return std::thread([this, read, stop] {
+		scanAll(read, stop);
+	});
+}
+
+template<typename READ>
+inline void LineIndex::scanAll(READ read, const std::atomic<bool> *stop) {
+	std::atomic<size_t> next { 0 };
+	auto worker = [&] {
+		std::unique_ptr<char[]> buffer(new char[BLOCK_SIZE + 2 * SEQUENCE_MARGIN]);
+		//Blocks are taken in order, so they are published steadily.
+		for (size_t index; (index = next++) < blocks.size();) {
+			if (stop && stop->load(std::memory_order_relaxed)) {
+				break;
+			}
+			size_t first = index * BLOCK_SIZE;
+			size_t readFirst = first - std::min(first, SEQUENCE_MARGIN);
+			size_t readLast = std::min(first + BLOCK_SIZE + SEQUENCE_MARGIN, size);
+			scan(index, read(readFirst, readLast - readFirst, buffer.get()), readFirst, readLast);
+			publish(index);
+		}
+	};
+	size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), blocks.size());
+	if (threads <= 1) {
+		worker();
+	} else {
+		std::vector<std::thread> pool;
+		for (size_t i = 0; i < threads; ++i) {
+			pool.emplace_back(worker);
+		}
+		for (auto &thread : pool) {
+			thread.join();
+		}
+	}
+	if (!complete()) {
+		abandon();
+	}
+}
+
+inline void LineIndex::scan(size_t index, const char *data, size_t readFirst, size_t readLast) {
+	Block &block = blocks[index];
+	size_t first = index * BLOCK_SIZE, last = std::min(first + BLOCK_SIZE, size);
+	const char *begin = data + (first - readFirst), *end = data + (last - readFirst);
+	block.newlines.assign(1, 0);
+	for (size_t checkpoint = 0; checkpoint < last - first; checkpoint += CHECKPOINT_SIZE) {
+		const char *checkpointEnd = begin + std::min(checkpoint + CHECKPOINT_SIZE, last - first);
+		uint32_t newlines = 0, continuations = 0;
+		for (const char *it = begin + checkpoint; (it = static_cast<const char*>(memchr(it, '\n', checkpointEnd - it))); ++it) {
+			++newlines;
+		}
+		for (const char *it = begin + checkpoint; it < checkpointEnd; it += 64) {
+			continuations += __builtin_popcountll(continuationMask(it, std::min<size_t>(64, checkpointEnd - it)));
+		}
+		block.newlines.push_back(block.newlines.back() + newlines);
+		if (continuations != 0 && block.continuations.empty()) {
+			block.continuations.assign(checkpoint / CHECKPOINT_SIZE + 1, 0);
+		}
+		if (!block.continuations.empty()) {
+			block.continuations.push_back(block.continuations.back() + continuations);
+		}
+	}
+	//Skip what the sequence started on the previous block uses, it validates that.
+	const char *validFirst = begin;
+	for (const char *it = begin; it > data && begin - it < ptrdiff_t(SEQUENCE_MARGIN);) {
+		if (!isContinuation(*--it)) {
+			validFirst = std::max(begin, std::min(end, it + leadLength(*it)));
+			break;
+		}
+	}
+	Utf8Validator validator;
+	validator.feed(validFirst, end);
+	for (const char *it = end; validator.inSequence() && it != data + (readLast - readFirst); ++it) {
+		validator.feed(it, it + 1);
+	}
+	block.valid = validator.valid();
+}
+
+inline void LineIndex::publish(size_t index) {
+	std::lock_guard<std::mutex> lock(mutex);
+	blocks[index].done = true;
+	size_t count = published.load(std::memory_order_relaxed);
+	for (; count < blocks.size() && blocks[count].done; ++count) {
+		Block const& block = blocks[count];
+		newlinesPrefix[count + 1] = newlinesPrefix[count] + block.newlines.back();
+		continuationsPrefix[count + 1] = continuationsPrefix[count] + (block.continuations.empty() ? 0 : block.continuations.back());
+		valid = valid && block.valid;
+	}
+	published.store(count, std::memory_order_release);
+	progress.notify_all();
+}
+
+inline void LineIndex::abandon() {
+	std::lock_guard<std::mutex> lock(mutex);
+	abandoned = true;
+	progress.notify_all();
+}
+
+inline void LineIndex::waitFor(size_t count) const {
+	if (published.load(std::memory_order_acquire) >= count) {
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mutex);
+	progress.wait(lock, [&] {
+		return published.load(std::memory_order_acquire) >= count || abandoned;
+	});
+}
+
+inline size_t LineIndex::blockOf(size_t pos) const {
+	size_t index = std::min(pos / BLOCK_SIZE, blocks.empty() ? 0 : blocks.size() - 1);
+	waitFor(std::min(index + 1, blocks.size()));
+	return index;
+}
+
+inline std::pair<size_t, size_t> LineIndex::before(size_t pos) const {
+	size_t index = blockOf(pos), count = published.load(std::memory_order_acquire);
+	if (index >= count) {
+		return {newlinesPrefix[count], continuationsPrefix[count]};
+	}
+	Block const& block = blocks[index];
+	size_t offset = std::min(pos, size) - index * BLOCK_SIZE;
+	size_t checkpoint = std::min(offset / CHECKPOINT_SIZE, block.newlines.size() - 1);
+	size_t newlines = newlinesPrefix[index] + block.newlines[checkpoint];
+	size_t continuations = continuationsPrefix[index] + (block.continuations.empty() ? 0 : block.continuations[checkpoint]);
+	offset -= checkpoint * CHECKPOINT_SIZE;
+	if (offset > 0) {
+		for (auto const& entry : scanned) {
+			if (entry.pos == pos) {
+				return entry.before;
+			}
+		}
+		char buffer[CHECKPOINT_SIZE];
+		size_t length;
+		const char *data = readCheckpoint(index, checkpoint, buffer, length);
+		newlines += std::count(data, data + offset, '\n');
+		if (!block.continuations.empty()) {
+			continuations += std::count_if(data, data + offset, isContinuation);
+		}
+		scanned[nextScanned++ % scanned.size()] = Scanned { pos, {newlines, continuations} };
+	}
+	return {newlines, continuations};
+}
+
+inline size_t LineIndex::newlinesBefore(size_t pos) const {
+	return before(pos).first;
+}
+
+inline size_t LineIndex::continuations(size_t pos) const {
+	return before(pos).second;
+}
+
+inline const char *LineIndex::readCheckpoint(size_t index, size_t checkpoint, char *buffer, size_t &length) const {
+	size_t first = index * BLOCK_SIZE + checkpoint * CHECKPOINT_SIZE;
+	length = std::min(CHECKPOINT_SIZE, std::min((index + 1) * BLOCK_SIZE, size) - first);
+	return reader(first, length, buffer);
+}
+
+}  // namespace sweet
+
+#endif /* SRC_LINEINDEX_HPP_ */
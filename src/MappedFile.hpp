@@ -0,0 +1,178 @@
+/**
+ * @file MappedFile.hpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#ifndef SRC_MAPPEDFILE_HPP_
+#define SRC_MAPPEDFILE_HPP_
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sweet {
+
+/**
+ * A whole file mapped into memory.
+ *
+ * An empty file has no mapping, so data() is null until it grows.
+ */
+class MappedFile {
+public:
+	/**
+	 * @brief Maps a file.
+	 * @param filename
+	 * @param writable if false the file is opened and mapped read only and
+	 * must exist, otherwise it is created if missing.
+	 */
+	MappedFile(std::string const& filename, bool writable = true);
+
+	/**
+	 * Dtor. Unmaps and closes the file.
+	 */
+	~MappedFile();
+
+	//We cant have these.
+	MappedFile(MappedFile const&) = delete;
+	MappedFile(MappedFile &&) = delete;
+	MappedFile &operator=(MappedFile const&) = delete;
+	MappedFile &operator=(MappedFile &&) = delete;
+
+	/**
+	 * @brief The mapped content.
+	 */
+	char *data() const;
+
+	/**
+	 * @brief The file size.
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief The file descriptor, for system calls.
+	 */
+	int descriptor() const;
+
+	/**
+	 * @brief Changes the file size and maps it again.
+	 *
+	 * Pointers to the old mapping are invalidated.
+	 * @param size
+	 */
+	void resize(size_t size);
+
+	/**
+	 * @brief Writes the modified pages back to the file.
+	 */
+	void sync();
+private:
+	/**
+	 * Maps size_ bytes of the file.
+	 */
+	void map();
+
+	/**
+	 * Unmaps the file, if mapped.
+	 */
+	void unmap();
+
+	[[noreturn]] void fail(std::string const& what) const;
+
+private:
+	std::string filename;
+	bool writable;
+	int fd;
+	char *data_ = nullptr;
+	size_t size_ = 0;
+};
+
+inline MappedFile::MappedFile(std::string const& filename, bool writable) :
+		filename(filename), writable(writable) {
+	fd = writable ? open(filename.c_str(), O_RDWR | O_CREAT, 0644) : open(filename.c_str(), O_RDONLY);
+	if (fd < 0) {
+		fail("Error opening");
+	}
+	struct stat status;
+	if (fstat(fd, &status) < 0) {
+		close(fd);
+		fail("Error reading size of");
+	}
+	size_ = status.st_size;
+	try {
+		map();
+	} catch (...) {
+		close(fd);
+		throw;
+	}
+}
+
+inline MappedFile::~MappedFile() {
+	unmap();
+	close(fd);
+}
+
+inline char *MappedFile::data() const {
+	return data_;
+}
+
+inline size_t MappedFile::size() const {
+	return size_;
+}
+
+inline int MappedFile::descriptor() const {
+	return fd;
+}
+
+inline void MappedFile::resize(size_t size) {
+	if (!writable) {
+		throw std::logic_error("Can not resize a read only mapping");
+	}
+	unmap();
+	if (ftruncate(fd, size) < 0) {
+		fail("Error resizing");
+	}
+	size_ = size;
+	map();
+}
+
+inline void MappedFile::sync() {
+	if (data_ && writable && msync(data_, size_, MS_SYNC) < 0) {
+		fail("Error syncing");
+	}
+}
+
+inline void MappedFile::map() {
+	if (size_ == 0) {
+		return;
+	}
+	int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+	void *address = mmap(nullptr, size_, protection, MAP_SHARED, fd, 0);
+	if (address == MAP_FAILED) {
+		fail("Error mapping");
+	}
+	data_ = static_cast<char*>(address);
+}
+
+inline void MappedFile::unmap() {
+	if (data_) {
+		munmap(data_, size_);
+		data_ = nullptr;
+	}
+}
+
+inline void MappedFile::fail(std::string const& what) const {
+	throw std::runtime_error(what + " '" + filename + "': " + std::strerror(errno));
+}
+
+}  // namespace sweet
+
+#endif /* SRC_MAPPEDFILE_HPP_ */
@@ -0,0 +1,238 @@
+/**
+ * @file MemoryIterator.hpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#ifndef SRC_MEMORYITERATOR_HPP_
+#define SRC_MEMORYITERATOR_HPP_
+
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <vector>
+
+#include "FileTarget.hpp"
+#include "MemoryNode.hpp"
+
+namespace sweet {
+
+/**
+ * A random access iterator over a MemoryNode tree.
+ *
+ * It caches the current leaf (and a block of it, for the leaves still on the
+ * file), so moving inside the same leaf is O(1) and jumping elsewhere is
+ * O(log n). The iterator is invalidated by any modification on the tree.
+ *
+ * The reference type is a plain char, as the original content only lives on
+ * the iterator cache. Like the std::vector<bool> iterators, it still claims
+ * the random access category, so the standard algorithms take the fast paths.
+ */
+class MemoryIterator {
+public:
+	using iterator_category = std::random_access_iterator_tag;
+	using value_type = char;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const char*;
+	using reference = char;
+public:
+	/**
+	 * @brief A singular iterator.
+	 */
+	MemoryIterator() = default;
+
+	/**
+	 * @brief Ctor
+	 * @param root the tree root.
+	 * @param internalTarget the file holding the original content.
+	 * @param pos the initial position.
+	 */
+	MemoryIterator(const MemoryNode *root, const FileTarget *internalTarget, size_t pos);
+
+	/**
+	 * @brief The current position.
+	 */
+	size_t position() const;
+
+	char operator*() const;
+	char operator[](difference_type n) const;
+
+	MemoryIterator &operator++();
+	MemoryIterator operator++(int);
+	MemoryIterator &operator--();
+	MemoryIterator operator--(int);
+	MemoryIterator &operator+=(difference_type n);
+	MemoryIterator &operator-=(difference_type n);
+	MemoryIterator operator+(difference_type n) const;
+	MemoryIterator operator-(difference_type n) const;
+	difference_type operator-(MemoryIterator const& other) const;
+
+	bool operator==(MemoryIterator const& other) const;
+	bool operator!=(MemoryIterator const& other) const;
+	bool operator<(MemoryIterator const& other) const;
+	bool operator>(MemoryIterator const& other) const;
+	bool operator<=(MemoryIterator const& other) const;
+	bool operator>=(MemoryIterator const& other) const;
+
+	/**
+	 * @brief Calls fn(first, last) for every contiguous segment in [first, last).
+	 *
+	 * This is the segmented access, so algorithms can run on each chunk
+	 * at full speed instead of going through the iterator.
+	 * @return false if it was stopped by fn.
+	 */
+	template<typename FUNCTION>
+	friend bool forEachSegment(MemoryIterator const& first, MemoryIterator const& last, FUNCTION &&fn);
+private:
+	/**
+	 * Finds the leaf for the current position.
+	 */
+	void seek() const;
+
+	/**
+	 * Loads the block of an original leaf containing the current position.
+	 */
+	void load() const;
+
+private:
+	static constexpr size_t BLOCK_SIZE = 4096;
+
+	const MemoryNode *root = nullptr;
+	const FileTarget *internalTarget = nullptr;
+	size_t pos = 0;
+
+	mutable const MemoryNode *leaf = nullptr;
+	mutable size_t leafFirst = 0, leafLast = 0;
+	mutable std::shared_ptr<const std::vector<char>> block;
+	mutable size_t blockFirst = 0;
+};
+
+inline MemoryIterator::MemoryIterator(const MemoryNode* root, const FileTarget* internalTarget, size_t pos) :
+		root(root), internalTarget(internalTarget), pos(pos) {
+}
+
+inline size_t MemoryIterator::position() const {
+	return pos;
+}
+
+inline char MemoryIterator::operator*() const {
+	if (leaf == nullptr || pos < leafFirst || pos >= leafLast) {
+		seek();
+	}
+	if (leaf->type == MemoryNode::MODIFIED_LEAF) {
+		return leaf->modified.content[pos - leafFirst];
+	}
+	if (leaf->type == MemoryNode::SHARED_LEAF) {
+		return leaf->shared.data.get()[pos - leafFirst];
+	}
+	if (!block || pos < blockFirst || pos >= blockFirst + block->size()) {
+		load();
+	}
+	return (*block)[pos - blockFirst];
+}
+
+inline char MemoryIterator::operator[](difference_type n) const {
+	return *(*this + n);
+}
+
+inline MemoryIterator& MemoryIterator::operator++() {
+	++pos;
+	return *this;
+}
+
+inline MemoryIterator MemoryIterator::operator++(int) {
+	MemoryIterator old = *this;
+	++pos;
+	return old;
+}
+
+inline MemoryIterator& MemoryIterator::operator--() {
+	--pos;
+	return *this;
+}
+
+inline MemoryIterator MemoryIterator::operator--(int) {
+	MemoryIterator old = *this;
+	--pos;
+	return old;
+}
+
+inline MemoryIterator& MemoryIterator::operator+=(difference_type n) {
+	pos += n;
+	return *this;
+}
+
+inline MemoryIterator& MemoryIterator::operator-=(difference_type n) {
+	pos -= n;
+	return *this;
+}
+
+inline MemoryIterator MemoryIterator::operator+(difference_type n) const {
+	MemoryIterator result = *this;
+	return result += n;
+}
+
+inline MemoryIterator operator+(MemoryIterator::difference_type n, MemoryIterator const& it) {
+	return it + n;
+}
+
+inline MemoryIterator MemoryIterator::operator-(difference_type n) const {
+	MemoryIterator result = *this;
+	return result -= n;
+}
+
+inline MemoryIterator::difference_type MemoryIterator::operator-(MemoryIterator const& other) const {
+	return difference_type(pos) - difference_type(other.pos);
+}
+
+inline bool MemoryIterator::operator==(MemoryIterator const& other) const {
+	return pos == other.pos;
+}
+
+inline bool MemoryIterator::operator!=(MemoryIterator const& other) const {
+	return pos != other.pos;
+}
+
+inline bool MemoryIterator::operator<(MemoryIterator const& other) const {
+	return pos < other.pos;
+}
+
+inline bool MemoryIterator::operator>(MemoryIterator const& other) const {
+	return pos > other.pos;
+}
+
+inline bool MemoryIterator::operator<=(MemoryIterator const& other) const {
+	return pos <= other.pos;
+}
+
+inline bool MemoryIterator::operator>=(MemoryIterator const& other) const {
+	return pos >= other.pos;
+}
+
+template<typename FUNCTION>
+inline bool forEachSegment(MemoryIterator const& first, MemoryIterator const& last, FUNCTION &&fn) {
+	if (first.pos >= last.pos) {
+		return true;
+	}
+	return first.root->forEachSegment(first.pos, last.pos - first.pos, fn, *first.internalTarget);
+}
+
+inline void MemoryIterator::seek() const {
+	leaf = root->leafAt(pos, leafFirst);
+	leafLast = leafFirst + leaf->size();
+	block.reset();
+}
+
+inline void MemoryIterator::load() const {
+	size_t offset = pos - leafFirst;
+	offset -= offset % BLOCK_SIZE;
+	auto data = std::make_shared<std::vector<char>>(std::min(BLOCK_SIZE, leafLast - leafFirst - offset));
+	data->resize(leaf->readLeaf(offset, data->size(), data->data(), *internalTarget));
+	block = move(data);
+	blockFirst = leafFirst + offset;
+}
+
+}  // namespace sweet
+
+#endif /* SRC_MEMORYITERATOR_HPP_ */
@@ -8,318 +8,1384 @@
 #ifndef SRC_MEMORYNODE_HPP_
 #define SRC_MEMORYNODE_HPP_
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "FileCopy.hpp"
+#include "FileTarget.hpp"
+#include "LineIndex.hpp"
+#include "MappedFile.hpp"
+#include "SwapFile.hpp"
+#include "TextChunk.hpp"
+#include "Utf8.hpp"
+
 namespace sweet {
 
+class MemoryIterator;
+
+/**
+ * How many newlines and codepoints some text has, or gained.
+ */
+struct TextCounts {
+	ptrdiff_t newlines = 0;
+	ptrdiff_t codepoints = 0;
+
+	TextCounts &operator+=(TextCounts const& other) {
+		newlines += other.newlines;
+		codepoints += other.codepoints;
+		return *this;
+	}
+	TextCounts &operator-=(TextCounts const& other) {
+		newlines -= other.newlines;
+		codepoints -= other.codepoints;
+		return *this;
+	}
+	TextCounts operator+(TextCounts const& other) const {
+		TextCounts result = *this;
+		return result += other;
+	}
+	TextCounts operator-(TextCounts const& other) const {
+		TextCounts result = *this;
+		return result -= other;
+	}
+};
+
+/**
+ * @brief Counts the newlines and codepoints on [first, last).
+ *
+ * Every byte that is not a continuation byte starts a codepoint.
+ */
+template<typename INPUT_ITERATOR>
+inline TextCounts countText(INPUT_ITERATOR first, INPUT_ITERATOR last) {
+	TextCounts counts;
+	for (; first != last; ++first) {
+		counts.newlines += *first == '\n';
+		counts.codepoints += !isContinuation(*first);
+	}
+	return counts;
+}
+
+/**
+ * @brief Counts the newlines and codepoints on a contiguous [first, last).
+ *
+ * The codepoints are counted 64 bytes at a time, through the continuation mask.
+ */
+inline TextCounts countText(const char *first, const char *last) {
+	TextCounts counts;
+	counts.newlines = std::count(first, last, '\n');
+	size_t continuations = 0;
+	for (auto it = first; it < last; it += 64) {
+		continuations += __builtin_popcountll(continuationMask(it, std::min<size_t>(64, last - it)));
+	}
+	counts.codepoints = (last - first) - continuations;
+	return counts;
+}
+
+/**
+ * What a tree is made of, as told by MemoryNode::stats().
+ */
+struct NodeStats {
+	size_t branches = 0;
+	size_t originalLeaves = 0;
+	size_t modifiedLeaves = 0;
+	size_t spilledLeaves = 0;
+	size_t sharedLeaves = 0;
+	size_t depth = 0;         ///< the levels down to the deepest leaf, the root included.
+	size_t modifiedBytes = 0; ///< characters held in memory by modified leaves.
+	size_t spilledBytes = 0;  ///< characters on the swap files.
+	size_t sharedBytes = 0;   ///< characters of adopted buffers and inserted files.
+};
+
 /**
  * A rope based memory node.
+ *
+ * Leaves hold either original content, a range of the target file,
+ * modified content in memory, or modified content spilled to a swap file.
+ * Spilled leaves behave like the original ones: they are read from the
+ * swap file and split without loading them back.
+ *
+ * Shared leaves hold a range of an immutable buffer adopted from the
+ * caller, so a large insertion is spliced in without copying. They are
+ * split and trimmed by aliasing the same buffer. The buffer can be another
+ * file mapped read only, so its content is only read when needed.
  */
 class MemoryNode {
+	friend class MemoryIterator;
 public:
+	static constexpr size_t npos = size_t(-1);
+
 	/**
 	 * Constructs a original content based node.
 	 * @param offset
 	 * @param size
+	 * @param index the line index of the original content.
 	 */
-	MemoryNode(size_t offset, size_t size);
+	MemoryNode(size_t offset, size_t size, const LineIndex *index);
 
 	/**
 	 * Constructs a modified content node.
 	 * @param content
 	 */
-	MemoryNode(std::deque<char>&& content, size_t originalSize);
+	MemoryNode(TextChunk&& content);
+
+	/**
+	 * Constructs a modified content node of any length.
+	 *
+	 * Content longer than a chunk becomes a balanced tree of chunks.
+	 * @param first
+	 * @param last
+	 */
+	template<typename FORWARD_ITERATOR>
+	MemoryNode(FORWARD_ITERATOR first, FORWARD_ITERATOR last);
+
+	/**
+	 * Takes the content of other, that is left only to be destroyed.
+	 */
+	MemoryNode(MemoryNode&& other);
+
+	/**
+	 * A shallow copy. A branch shares its children with other.
+	 */
+	MemoryNode(MemoryNode const& other);
 
 	//dtor
 	~MemoryNode();
 
+	/**
+	 * The number of characters on this node.
+	 */
+	size_t size() const;
+
 	/**
 	 * View a range
 	 * @param pos
 	 * @param count
 	 * @param out
 	 * @param internalTarget
+	 * @return the output iterator past the last written character.
 	 */
 	template<typename OUTPUT_ITERATOR>
-	void viewRange(size_t pos, size_t count, OUTPUT_ITERATOR out, const FileTarget& internalTarget) const;
+	OUTPUT_ITERATOR viewRange(size_t pos, size_t count, OUTPUT_ITERATOR out, const FileTarget& internalTarget) const;
+
+	/**
+	 * Calls fn(first, last) for every contiguous segment of the range, in order.
+	 *
+	 * The iterators given to fn are valid only during the call. If fn
+	 * returns false the traversal stops.
+	 * @param pos
+	 * @param count
+	 * @param fn
+	 * @param internalTarget
+	 * @return false if it was stopped by fn.
+	 */
+	template<typename FUNCTION>
+	bool forEachSegment(size_t pos, size_t count, FUNCTION &&fn, const FileTarget& internalTarget) const;
+
+	/**
+	 * Finds the leaf containing pos.
+	 * @param pos
+	 * @param leafPos receives the position where the leaf starts.
+	 */
+	const MemoryNode *leafAt(size_t pos, size_t &leafPos) const;
+
+	/**
+	 * The number of newlines and codepoints on this node.
+	 */
+	TextCounts counts() const;
+
+	/**
+	 * The number of newlines and codepoints before pos.
+	 * @param pos
+	 */
+	TextCounts countsBefore(size_t pos) const;
+
+	/**
+	 * Finds the nth newline.
+	 * @param nth zero based
+	 * @return its position or npos if there is not enough lines.
+	 */
+	size_t findNewline(size_t nth) const;
+
+	/**
+	 * Finds where the nth codepoint starts.
+	 * @param nth zero based
+	 * @return its position or npos if there is not enough codepoints.
+	 */
+	size_t findCodepoint(size_t nth) const;
 
 	/**
 	 * Replace text starting at pos.
 	 * @param pos
 	 * @param first
 	 * @param last
+	 * @return how many newlines and codepoints were added (or removed, if negative).
 	 */
 	template<typename FORWARD_ITERATOR>
-	void replace(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last);
+	TextCounts replace(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last);
 
 	/**
 	 * Insert text at pos.
 	 * @param pos
 	 * @param first
 	 * @param last
+	 * @return how many newlines and codepoints were inserted.
 	 */
 	template<typename FORWARD_ITERATOR>
-	void insert(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last);
+	TextCounts insert(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last);
+
+	/**
+	 * Insert a shared buffer at pos, without copying it.
+	 * @param pos
+	 * @param data the buffer, that must not change while shared.
+	 * @param size
+	 * @param file the file data maps into, if any.
+	 * @return how many newlines and codepoints were inserted.
+	 */
+	TextCounts insertShared(size_t pos, std::shared_ptr<const char> data, size_t size,
+			const MappedFile *file = nullptr);
+
+	/**
+	 * Insert the same text at several positions, in a single walk.
+	 * @param base the position of this node.
+	 * @param posFirst first of the sorted positions.
+	 * @param posLast last of the sorted positions.
+	 * @param first
+	 * @param last
+	 * @return how many newlines and codepoints were inserted.
+	 */
+	template<typename POSITION_ITERATOR, typename FORWARD_ITERATOR>
+	TextCounts insertAll(size_t base, POSITION_ITERATOR posFirst, POSITION_ITERATOR posLast, FORWARD_ITERATOR first,
+			FORWARD_ITERATOR last);
 
 	/**
 	 * Erase text at pos.
 	 * @param pos
 	 * @param count
+	 * @return how many newlines and codepoints were erased.
+	 */
+	TextCounts erase(size_t pos, size_t count);
+
+	/**
+	 * Erase several ranges, in a single walk.
+	 * @param base the position of this node.
+	 * @param rangeFirst first of the sorted, non overlapping (pos, count) pairs.
+	 * @param rangeLast last of the sorted, non overlapping (pos, count) pairs.
+	 * @return how many newlines and codepoints were erased.
+	 */
+	template<typename RANGE_ITERATOR>
+	TextCounts eraseAll(size_t base, RANGE_ITERATOR rangeFirst, RANGE_ITERATOR rangeLast);
+
+	/**
+	 * A tree with count characters at pos, sharing the nodes fully inside the range.
+	 *
+	 * Only the nodes along the range ends are new, so it takes O(log n).
+	 * The shared nodes are copied before they are changed on either tree.
+	 * @param pos
+	 * @param count
+	 */
+	std::shared_ptr<MemoryNode> slice(size_t pos, size_t count);
+
+	/**
+	 * Inserts a tree at pos, sharing it.
+	 * @return how many newlines and codepoints were inserted.
+	 */
+	TextCounts insertTree(size_t pos, std::shared_ptr<MemoryNode> node);
+
+	/**
+	 * Splits at pos, keeping the content before it and returning the rest as another tree.
+	 *
+	 * No content is copied: only the leaf on pos is split, as the
+	 * edits do, and the branches along the way are rearranged, so it
+	 * takes O(log n).
+	 * @param pos clamped to the size.
+	 * @return the content from pos on.
+	 */
+	std::shared_ptr<MemoryNode> split(size_t pos);
+
+	/**
+	 * Appends the content of other, sharing it, in O(1).
+	 * @param other
+	 * @return how many newlines and codepoints were appended.
 	 */
-	void erase(size_t pos, size_t count);
+	TextCounts concat(std::shared_ptr<MemoryNode> other);
 
-	void flush(FileTarget& target, ptrdiff_t offset = 0);
+	/**
+	 * Moves the content that refers to the target file, or to a swap file
+	 * other than swap, to swap, so it survives the target flush and the
+	 * other swap being cleared. The changed nodes are copied if shared.
+	 *
+	 * The original content is counted by its line index, or read back from
+	 * swap if the index was not complete.
+	 * @param node
+	 * @param swap
+	 * @param internalTarget
+	 */
+	static void relocate(std::shared_ptr<MemoryNode> &node, SwapFile& swap, const FileTarget& internalTarget);
+
+	/**
+	 * Writes the content to target.
+	 *
+	 * The original ranges moving left are written first, front to back,
+	 * then the ones moving right, back to front, so none is overwritten
+	 * before it is moved. That only holds for ranges still in their
+	 * original order, so the ones moved or pasted out of it are staged on
+	 * a scratch file first. The modified content goes last, on the gaps.
+	 * Ranges of files, the original, spilled and mapped ones, are copied
+	 * by the kernel where it can; the in memory content is written in
+	 * large blocks. The target stdio position is reset.
+	 * Afterwards this node is an original leaf spanning the written content.
+	 * @param target
+	 * @param index the index the new original leaves refer to. It
+	 * must be rebuilt by the caller, as the file changed.
+	 * @return how many characters were written, the moved original ones included.
+	 */
+	size_t flush(FileTarget& target, const LineIndex *index);
+
+	/**
+	 * Writes the content to fd, an empty file that is to replace the
+	 * target, as flush() does but with every range in order, as nothing
+	 * is overwritten.
+	 * Afterwards this node is an original leaf spanning the written content.
+	 * @param fd
+	 * @param internalTarget
+	 * @param index the index the new original leaves refer to, to be rebuilt.
+	 * @return how many characters were written.
+	 */
+	size_t flushTo(int fd, const FileTarget& internalTarget, const LineIndex *index);
+
+	/**
+	 * Moves modified leaves to the swap file, the farthest from pos first,
+	 * until at most budget characters of them are left in memory.
+	 *
+	 * Leaves smaller than MIN_SPILL are never moved, nor the ones shared
+	 * with registers or pasted more than once, as moving them would free
+	 * nothing while the other trees keep them.
+	 * @param swap
+	 * @param pos
+	 * @param budget
+	 * @return the number of modified characters left in memory, the shared ones left out.
+	 */
+	size_t spill(SwapFile& swap, size_t pos, size_t budget);
+
+	/**
+	 * Counts the nodes by type, and what they hold. It walks the whole tree.
+	 */
+	NodeStats stats() const;
+
+	/**
+	 * How many nodes were allocated by the process.
+	 */
+	static size_t allocations();
+
+	/// The smallest leaf worth moving to the swap file.
+	static constexpr size_t MIN_SPILL = TextChunk::CAPACITY / 4;
+	/// How much of its chunk new content can fill, so there is room for edits.
+	static constexpr size_t FILL = TextChunk::CAPACITY * 3 / 4;
+	/// How much in memory content the flush gathers for a single write.
+	static constexpr size_t FLUSH_BLOCK = 1024 * 1024;
 private:
 	/**
-	 * Split at pos.
+	 * Split a leaf at pos, making it a branch of two leaves.
 	 * @param pos
 	 */
-	void split(size_t pos);
+	void splitLeaf(size_t pos);
+
+	/**
+	 * Splits the tree node at pos, as split(). It may be replaced by a
+	 * new node, so it is not changed if shared.
+	 */
+	static std::shared_ptr<MemoryNode> splitOff(std::shared_ptr<MemoryNode> &node, size_t pos);
+
+	/**
+	 * A tree with the content of left followed by right, leaving the empty ones out.
+	 */
+	static std::shared_ptr<MemoryNode> join(std::shared_ptr<MemoryNode> left, std::shared_ptr<MemoryNode> right);
+
+	/**
+	 * Makes this, that must hold nothing, a modified content node of any length.
+	 */
+	template<typename FORWARD_ITERATOR>
+	void assign(FORWARD_ITERATOR first, FORWARD_ITERATOR last);
+
+	/**
+	 * Inserts a node at pos, making a branch of the leaf it falls on.
+	 */
+	TextCounts splice(size_t pos, std::shared_ptr<MemoryNode> node);
+
+	/**
+	 * The node, copied first if it is shared with another tree.
+	 */
+	static MemoryNode &own(std::shared_ptr<MemoryNode> &node);
+
+	/**
+	 * The slice of a node. See slice().
+	 */
+	static std::shared_ptr<MemoryNode> sliceOf(std::shared_ptr<MemoryNode> const& node, size_t pos, size_t count);
+
+	/**
+	 * If the node has content relocate() must move.
+	 */
+	bool needsRelocation(const SwapFile &swap) const;
+
+	/**
+	 * Writes a modified, spilled or shared leaf at pos of fd, the in
+	 * memory content through write(pos, first, last).
+	 * @return how many characters were written by the kernel or directly.
+	 */
+	template<typename WRITE>
+	size_t writeLeaf(size_t pos, int fd, WRITE &&write) const;
+
+	/**
+	 * Makes this an original leaf spanning the first total characters of the target.
+	 */
+	void becomeOriginal(size_t total, const LineIndex *index);
+
+	/**
+	 * Which of the leaves are original ones in their original order, the
+	 * longest run of them, so they can be moved in place.
+	 */
+	static std::vector<bool> inOrder(std::vector<std::pair<size_t, MemoryNode*>> const& leaves);
+
+	/**
+	 * Allocates a node, counting it.
+	 */
+	template<typename... ARGS>
+	static std::shared_ptr<MemoryNode> make(ARGS&&... args);
+
+	/**
+	 * Adds the nodes of this, that is at the given depth, to stats.
+	 */
+	void collectStats(NodeStats &stats, size_t depth) const;
+
+	/**
+	 * Appends the leaves to leaves, with their positions.
+	 */
+	void allLeaves(size_t base, std::vector<std::pair<size_t, MemoryNode*>> &leaves);
+
+	/**
+	 * Appends the leaves no other tree shares to leaves, with their
+	 * positions, so each comes only once and can be changed in place.
+	 */
+	void ownedLeaves(size_t base, std::vector<std::pair<size_t, MemoryNode*>> &leaves);
 
 	/**
-	 * Gets the offset.
-	 * @return
+	 * The counts of the original content on [first, last).
 	 */
-	ptrdiff_t offset() const;
+	TextCounts originalCounts(size_t first, size_t last) const;
+
+	/**
+	 * The counts of the spilled content on [first, last).
+	 */
+	TextCounts spilledCounts(size_t first, size_t last) const;
+
+	/**
+	 * The counts of the modified content on [first, last).
+	 */
+	TextCounts modifiedCounts(size_t first, size_t last) const;
+
+	/**
+	 * Reads a range of an original or spilled leaf.
+	 * @return the number of characters read.
+	 */
+	size_t readLeaf(size_t pos, size_t count, char *buffer, const FileTarget& internalTarget) const;
+
+	/**
+	 * Calls fn(pos, first, last) for every block read from a spilled leaf
+	 * range, until it returns false.
+	 */
+	template<typename FUNCTION>
+	void scanSpilled(size_t first, size_t last, FUNCTION &&fn) const;
+
+	/**
+	 * Constructs a spilled content node.
+	 */
+	MemoryNode(SwapFile *swap, size_t offset, size_t size, TextCounts counts, bool aliased = false);
+
+	/**
+	 * Constructs a shared content node.
+	 */
+	MemoryNode(std::shared_ptr<const char> data, size_t size, TextCounts counts, const MappedFile *file);
+
+	/**
+	 * Constructs a branch.
+	 */
+	MemoryNode(std::shared_ptr<MemoryNode> left, std::shared_ptr<MemoryNode> right);
 
 private:
 	enum Type {
 		BRANCH,
 		ORIGINAL_LEAF,
 		MODIFIED_LEAF,
+		SPILLED_LEAF,
+		SHARED_LEAF,
 	} type;
 	union {
 		struct {
-			std::unique_ptr<MemoryNode> left;
-			std::unique_ptr<MemoryNode> right;
+			std::shared_ptr<MemoryNode> left;
+			std::shared_ptr<MemoryNode> right;
 			size_t weight;
+			TextCounts counts; ///< counts on the left
 		} branch;
 		struct {
 			size_t offset;
 			size_t size;
+			const LineIndex *index;
 		} original;
 		struct {
-			std::deque<char> content;
-			size_t originalSize;
+			TextChunk content;
 		} modified;
+		struct {
+			size_t offset;
+			size_t size;
+			TextCounts counts;
+			SwapFile *swap;
+			bool aliased; ///< if other leaves may refer to the range, so it is never released.
+		} spilled;
+		struct {
+			std::shared_ptr<const char> data;
+			size_t size;
+			TextCounts counts;
+			const MappedFile *file; ///< the file data maps into, if any.
+		} shared;
 	};
+
+	static inline std::atomic<size_t> allocated { 0 };
 };
 
-inline MemoryNode::MemoryNode(size_t offset, size_t size) {
+inline MemoryNode::MemoryNode(size_t offset, size_t size, const LineIndex *index) {
 	type = ORIGINAL_LEAF;
 	original.offset = offset;
 	original.size = size;
+	original.index = index;
 }
 
-inline MemoryNode::MemoryNode(std::deque<char>&& content, size_t originalSize) {
+inline MemoryNode::MemoryNode(TextChunk&& content) {
 	type = MODIFIED_LEAF;
-	new (&modified.content) std::deque<char>(move(content));
-	modified.originalSize = originalSize;
+	new (&modified.content) TextChunk(std::move(content));
 }
 
-inline MemoryNode::~MemoryNode() {
+template<typename FORWARD_ITERATOR>
+inline MemoryNode::MemoryNode(FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
+	assign(first, last);
+}
+
+inline MemoryNode::MemoryNode(SwapFile *swap, size_t offset, size_t size, TextCounts counts, bool aliased) {
+	type = SPILLED_LEAF;
+	spilled.offset = offset;
+	spilled.size = size;
+	spilled.counts = counts;
+	spilled.swap = swap;
+	spilled.aliased = aliased;
+}
+
+inline MemoryNode::MemoryNode(std::shared_ptr<const char> data, size_t size, TextCounts counts,
+		const MappedFile *file) {
+	type = SHARED_LEAF;
+	new (&shared.data) std::shared_ptr<const char>(std::move(data));
+	shared.size = size;
+	shared.counts = counts;
+	shared.file = file;
+}
+
+inline MemoryNode::MemoryNode(std::shared_ptr<MemoryNode> left, std::shared_ptr<MemoryNode> right) {
+	type = BRANCH;
+	new (&branch.left) std::shared_ptr<MemoryNode>(std::move(left));
+	new (&branch.right) std::shared_ptr<MemoryNode>(std::move(right));
+	branch.weight = branch.left->size();
+	branch.counts = branch.left->counts();
+}
+
+inline MemoryNode::MemoryNode(MemoryNode&& other) {
+	type = other.type;
 	switch (type) {
 	case BRANCH:
-		branch.left.~unique_ptr();
-		branch.right.~unique_ptr();
+		new (&branch.left) std::shared_ptr<MemoryNode>(std::move(other.branch.left));
+		new (&branch.right) std::shared_ptr<MemoryNode>(std::move(other.branch.right));
+		branch.weight = other.branch.weight;
+		branch.counts = other.branch.counts;
 		break;
 	case ORIGINAL_LEAF:
+		original = other.original;
 		break;
 	case MODIFIED_LEAF:
-		modified.content.~deque();
+		new (&modified.content) TextChunk(std::move(other.modified.content));
+		break;
+	case SPILLED_LEAF:
+		spilled = other.spilled;
+		break;
+	case SHARED_LEAF:
+		new (&shared.data) std::shared_ptr<const char>(std::move(other.shared.data));
+		shared.size = other.shared.size;
+		shared.counts = other.shared.counts;
+		shared.file = other.shared.file;
 		break;
 	}
 }
 
-template<typename OUTPUT_ITERATOR>
-inline void MemoryNode::viewRange(size_t pos, size_t count, OUTPUT_ITERATOR out, const FileTarget& internalTarget) const {
+inline MemoryNode::MemoryNode(MemoryNode const& other) {
+	type = other.type;
 	switch (type) {
 	case BRANCH:
-		if (pos < branch.weight) {
-			branch.left->viewRange(pos, std::min(branch.weight, count), out, internalTarget);
-		}
-		if (pos + count > branch.weight) {
-			branch.right->viewRange(0, count - branch.weight, out, internalTarget);
-		}
+		new (&branch.left) std::shared_ptr<MemoryNode>(other.branch.left);
+		new (&branch.right) std::shared_ptr<MemoryNode>(other.branch.right);
+		branch.weight = other.branch.weight;
+		branch.counts = other.branch.counts;
 		break;
 	case ORIGINAL_LEAF:
-		internalTarget.viewRange(pos + original.offset, count, out);
+		original = other.original;
 		break;
 	case MODIFIED_LEAF:
-		std::copy(modified.content.begin(), modified.content.end(), out);
+		new (&modified.content) TextChunk(other.modified.content);
+		break;
+	case SPILLED_LEAF:
+		spilled = other.spilled;
+		spilled.aliased = true;
+		break;
+	case SHARED_LEAF:
+		new (&shared.data) std::shared_ptr<const char>(other.shared.data);
+		shared.size = other.shared.size;
+		shared.counts = other.shared.counts;
+		shared.file = other.shared.file;
 		break;
 	}
 }
 
-template<typename FORWARD_ITERATOR>
-inline void MemoryNode::replace(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
-	using namespace std;
+inline MemoryNode::~MemoryNode() {
 	switch (type) {
 	case BRANCH:
-		if (pos < branch.weight) {
-			if (distance(first, last) <= ptrdiff_t(branch.weight)) {
-				branch.left->replace(pos, first, last);
-			} else {
-				auto middle = next(first, branch.weight);
-				branch.left->replace(pos, first, middle);
-				branch.right->replace(0, middle, last);
-			}
-		} else {
-			branch.right->replace(pos - branch.weight, first, last);
-		}
+		branch.left.~shared_ptr();
+		branch.right.~shared_ptr();
 		break;
 	case ORIGINAL_LEAF:
-		if (pos > 0) {
-			split(pos);
-			branch.right->replace(0, first, last);
-		} else if (distance(first, last) < ptrdiff_t(original.size)) {
-			split(distance(first, last));
-			branch.left->replace(pos, first, last);
-		} else {
-			size_t originalSize = original.size;
-			type = MODIFIED_LEAF;
-			new (&modified.content) deque<char>(first, last);
-			modified.originalSize = originalSize;
-		}
-
 		break;
 	case MODIFIED_LEAF:
-		if (distance(first, last) > ptrdiff_t(modified.content.size() - pos)) {
-			auto middle = next(first, modified.content.size() - pos);
-			copy(first, middle, modified.content.begin() + pos);
-			copy(middle, last, back_inserter(modified.content));
-		} else {
-			copy(first, last, modified.content.begin() + pos);
-		}
+		modified.content.~TextChunk();
+		break;
+	case SPILLED_LEAF:
+		break;
+	case SHARED_LEAF:
+		shared.data.~shared_ptr();
 		break;
 	}
 }
 
-template<typename FORWARD_ITERATOR>
-inline void MemoryNode::insert(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
-	using namespace std;
+inline size_t MemoryNode::size() const {
 	switch (type) {
 	case BRANCH:
-		if (pos <= branch.weight) {
-			branch.left->insert(pos, first, last);
-			branch.weight += distance(first, last);
-		} else {
-			branch.right->insert(pos - branch.weight, first, last);
-		}
-		break;
+		return branch.weight + branch.right->size();
 	case ORIGINAL_LEAF:
-		if (pos == original.size) {
-			replace(pos, first, last);
-		} else {
-			split(pos);
-			branch.left->insert(pos, first, last);
-			branch.weight += distance(first, last);
-		}
-		break;
+		return original.size;
 	case MODIFIED_LEAF:
-		if (pos == modified.content.size()) {
-			replace(pos, first, last);
-		} else {
-			split(pos);
-			branch.left->insert(pos, first, last);
-		}
-		break;
+		return modified.content.size();
+	case SPILLED_LEAF:
+		return spilled.size;
+	case SHARED_LEAF:
+		return shared.size;
 	}
+	throw std::logic_error("It should never happen");
 }
 
-inline void MemoryNode::erase(size_t pos, size_t count) {
-	//TODO Remove node if it is empty
+template<typename OUTPUT_ITERATOR>
+inline OUTPUT_ITERATOR MemoryNode::viewRange(size_t pos, size_t count, OUTPUT_ITERATOR out,
+		const FileTarget& internalTarget) const {
+	forEachSegment(pos, count, [&out](auto first, auto last) {
+		out = std::copy(first, last, out);
+		return true;
+	}, internalTarget);
+	return out;
+}
+
+template<typename FUNCTION>
+inline bool MemoryNode::forEachSegment(size_t pos, size_t count, FUNCTION &&fn,
+		const FileTarget& internalTarget) const {
+	using namespace std;
 	switch (type) {
 	case BRANCH:
 		if (pos < branch.weight) {
-			if (pos + count <= branch.weight) {
-				branch.left->erase(pos, count);
-				branch.weight -= count;
-			} else {
-				auto leftCount = branch.weight - pos;
-				branch.left->erase(pos, leftCount);
-				branch.right->erase(0, count - leftCount);
-				branch.weight -= leftCount;
+			size_t leftCount = min(branch.weight - pos, count);
+			if (!branch.left->forEachSegment(pos, leftCount, fn, internalTarget)) {
+				return false;
 			}
-		} else {
-			branch.right->erase(pos - branch.weight, count);
+			pos += leftCount;
+			count -= leftCount;
 		}
-		break;
+		if (count > 0) {
+			return branch.right->forEachSegment(pos - branch.weight, count, fn, internalTarget);
+		}
+		return true;
 	case ORIGINAL_LEAF:
-		if (pos == 0) {
-			auto diff = std::min(count, original.size);
-			original.offset += diff;
-			original.size -= diff;
-		} else if (pos + count >= original.size) {
-			original.size -= std::min(count, original.size);
-		} else {
-			split(pos);
-			branch.right->erase(0, count);
+	case SPILLED_LEAF: {
+		constexpr size_t BLOCK_SIZE = 64 * 1024;
+		count = min(count, size() - min(pos, size()));
+		unique_ptr<char[]> buffer(new char[min(count, BLOCK_SIZE)]);
+		while (count > 0) {
+			size_t read = readLeaf(pos, min(count, BLOCK_SIZE), buffer.get(), internalTarget);
+			if (read == 0) {
+				break;
+			}
+			if (!fn((const char *) buffer.get(), (const char *) buffer.get() + read)) {
+				return false;
+			}
+			pos += read;
+			count -= read;
 		}
-
-		break;
-	case MODIFIED_LEAF:
-		if (pos == 0) {
-			modified.content.erase(modified.content.begin(), modified.content.begin() + count);
-		} else if (pos + count >= modified.content.size()) {
-			modified.content.erase(modified.content.begin() + pos, modified.content.end());
+		return true;
+	}
+	case MODIFIED_LEAF: {
+		return modified.content.forEachSpan(pos, count, fn);
+	}
+	case SHARED_LEAF: {
+		pos = min(pos, shared.size);
+		count = min(count, shared.size - pos);
+		if (count == 0) {
+			return true;
+		}
+		auto first = shared.data.get() + pos;
+		return fn(first, first + count);
+	}
+	}
+	throw std::logic_error("It should never happen");
+}
+
+inline const MemoryNode* MemoryNode::leafAt(size_t pos, size_t& leafPos) const {
+	const MemoryNode *node = this;
+	leafPos = 0;
+	while (node->type == BRANCH) {
+		if (pos < node->branch.weight) {
+			node = node->branch.left.get();
 		} else {
-			split(pos);
-			branch.right->erase(0, count);
+			pos -= node->branch.weight;
+			leafPos += node->branch.weight;
+			node = node->branch.right.get();
 		}
 	}
+	return node;
 }
 
-inline void MemoryNode::flush(FileTarget& target, ptrdiff_t offset) {
-	using namespace std;
+inline TextCounts MemoryNode::counts() const {
+	switch (type) {
+	case BRANCH:
+		return branch.counts + branch.right->counts();
+	case ORIGINAL_LEAF:
+		return originalCounts(0, original.size);
+	case MODIFIED_LEAF:
+		return modifiedCounts(0, modified.content.size());
+	case SPILLED_LEAF:
+		return spilled.counts;
+	case SHARED_LEAF:
+		return shared.counts;
+	}
+	throw std::logic_error("It should never happen");
+}
+
+inline TextCounts MemoryNode::countsBefore(size_t pos) const {
+	switch (type) {
+	case BRANCH:
+		if (pos < branch.weight) {
+			return branch.left->countsBefore(pos);
+		}
+		return branch.counts + branch.right->countsBefore(pos - branch.weight);
+	case ORIGINAL_LEAF:
+		return originalCounts(0, std::min(pos, original.size));
+	case MODIFIED_LEAF:
+		return modifiedCounts(0, pos);
+	case SPILLED_LEAF:
+		//Reads the shorter side.
+		if (pos >= spilled.size) {
+			return spilled.counts;
+		} else if (pos > spilled.size / 2) {
+			return spilled.counts - spilledCounts(pos, spilled.size);
+		}
+		return spilledCounts(0, pos);
+	case SHARED_LEAF: {
+		//Counts the shorter side.
+		auto data = shared.data.get();
+		if (pos >= shared.size) {
+			return shared.counts;
+		} else if (pos > shared.size / 2) {
+			return shared.counts - countText(data + pos, data + shared.size);
+		}
+		return countText(data, data + pos);
+	}
+	}
+	throw std::logic_error("It should never happen");
+}
+
+inline size_t MemoryNode::findNewline(size_t nth) const {
 	switch (type) {
 	case BRANCH: {
-		ptrdiff_t leftOffset = branch.left->offset();
-		if (leftOffset > 0) {
-			target.go(branch.weight);
-			branch.right->flush(target, offset + leftOffset);
-			target.go(-branch.weight - branch.right->original.size - offset);
-			branch.left->flush(target, offset);
-		} else {
-			branch.left->flush(target, offset);
-			branch.right->flush(target, offset + leftOffset);
-		}
-		size_t foffset = branch.left->original.offset;
-		size_t size = branch.left->original.size + branch.right->original.size;
-		branch.left.~unique_ptr();
-		branch.right.~unique_ptr();
-		type = ORIGINAL_LEAF;
-		original.offset = foffset;
-		original.size = size;
-		break;
+		if (nth < size_t(branch.counts.newlines)) {
+			return branch.left->findNewline(nth);
+		}
+		size_t pos = branch.right->findNewline(nth - branch.counts.newlines);
+		return pos == npos ? npos : pos + branch.weight;
+	}
+	case ORIGINAL_LEAF: {
+		size_t pos = original.index->find(original.offset, original.offset + original.size, nth);
+		return pos == LineIndex::npos ? npos : pos - original.offset;
+	}
+	case MODIFIED_LEAF: {
+		size_t found = npos, pos = 0;
+		modified.content.forEachSpan(0, modified.content.size(), [&](const char *first, const char *last) {
+			for (auto it = first; (it = static_cast<const char*>(memchr(it, '\n', last - it))); ++it) {
+				if (nth-- == 0) {
+					found = pos + (it - first);
+					return false;
+				}
+			}
+			pos += last - first;
+			return true;
+		});
+		return found;
+	}
+	case SPILLED_LEAF: {
+		size_t found = npos;
+		if (nth < size_t(spilled.counts.newlines)) {
+			scanSpilled(0, spilled.size, [&](size_t pos, const char *first, const char *last) {
+				for (auto it = first; (it = static_cast<const char*>(memchr(it, '\n', last - it))); ++it) {
+					if (nth-- == 0) {
+						found = pos + (it - first);
+						return false;
+					}
+				}
+				return true;
+			});
+		}
+		return found;
+	}
+	case SHARED_LEAF: {
+		auto first = shared.data.get(), last = first + shared.size;
+		for (auto it = first; (it = static_cast<const char*>(memchr(it, '\n', last - it))); ++it) {
+			if (nth-- == 0) {
+				return it - first;
+			}
+		}
+		return npos;
+	}
+	}
+	throw std::logic_error("It should never happen");
+}
+
+inline size_t MemoryNode::findCodepoint(size_t nth) const {
+	switch (type) {
+	case BRANCH: {
+		if (nth < size_t(branch.counts.codepoints)) {
+			return branch.left->findCodepoint(nth);
+		}
+		size_t pos = branch.right->findCodepoint(nth - branch.counts.codepoints);
+		return pos == npos ? npos : pos + branch.weight;
 	}
 	case ORIGINAL_LEAF: {
-		ptrdiff_t cPos = target.tell();
-		ptrdiff_t realOffset = target.tell() - original.offset;
-		if (realOffset != 0) {
-			string buffer;
-			buffer.reserve(original.size); //TODO make it in chunks...
-			target.viewRange(original.offset, original.size, back_inserter(buffer));
-			target.go(cPos - target.tell());
-			target.replace(buffer.begin(), buffer.end());
-			original.offset += realOffset - offset;
+		size_t pos = original.index->findCodepoint(original.offset, original.offset + original.size, nth);
+		return pos == LineIndex::npos ? npos : pos - original.offset;
+	}
+	case MODIFIED_LEAF:
+		for (size_t pos = 0; pos < modified.content.size(); ++pos) {
+			if (!isContinuation(modified.content[pos]) && nth-- == 0) {
+				return pos;
+			}
+		}
+		return npos;
+	case SPILLED_LEAF: {
+		size_t found = npos;
+		if (nth < size_t(spilled.counts.codepoints)) {
+			scanSpilled(0, spilled.size, [&](size_t pos, const char *first, const char *last) {
+				for (auto it = first; it != last; ++it) {
+					if (!isContinuation(*it) && nth-- == 0) {
+						found = pos + (it - first);
+						return false;
+					}
+				}
+				return true;
+			});
+		}
+		return found;
+	}
+	case SHARED_LEAF:
+		for (size_t pos = 0; pos < shared.size; ++pos) {
+			if (!isContinuation(shared.data.get()[pos]) && nth-- == 0) {
+				return pos;
+			}
+		}
+		return npos;
+	}
+	throw std::logic_error("It should never happen");
+}
+
+template<typename FORWARD_ITERATOR>
+inline TextCounts MemoryNode::replace(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
+	using namespace std;
+	switch (type) {
+	case BRANCH:
+		if (pos < branch.weight) {
+			if (distance(first, last) <= ptrdiff_t(branch.weight - pos)) {
+				TextCounts delta = own(branch.left).replace(pos, first, last);
+				branch.counts += delta;
+				return delta;
+			} else {
+				auto middle = next(first, branch.weight - pos);
+				TextCounts delta = own(branch.left).replace(pos, first, middle);
+				branch.counts += delta;
+				return delta + own(branch.right).replace(0, middle, last);
+			}
+		}
+		return own(branch.right).replace(pos - branch.weight, first, last);
+	case ORIGINAL_LEAF:
+	case SPILLED_LEAF:
+	case SHARED_LEAF:
+		if (pos > 0) {
+			splitLeaf(pos);
+			return own(branch.right).replace(0, first, last);
+		} else if (distance(first, last) < ptrdiff_t(size())) {
+			splitLeaf(distance(first, last));
+			TextCounts delta = own(branch.left).replace(pos, first, last);
+			branch.counts += delta;
+			return delta;
 		} else {
-			target.go(original.size);
+			TextCounts removed = counts();
+			if (type == SPILLED_LEAF && !spilled.aliased) {
+				spilled.swap->release(spilled.offset, spilled.size);
+			} else if (type == SHARED_LEAF) {
+				shared.data.~shared_ptr();
+			}
+			assign(first, last);
+			return countText(first, last) - removed;
 		}
-		break;
+	case MODIFIED_LEAF: {
+		auto &content = modified.content;
+		size_t count = distance(first, last);
+		size_t overlap = min(count, content.size() - pos);
+		TextCounts removed = modifiedCounts(pos, pos + overlap);
+		if (count - overlap <= content.room()) {
+			content.replace(pos, first, last);
+			return countText(first, last) - removed;
+		}
+		//What does not fit goes to new chunks on the right.
+		auto middle = next(first, overlap);
+		content.replace(pos, first, middle);
+		TextChunk left = std::move(content);
+		content.~TextChunk();
+		type = BRANCH;
+		new (&branch.left) shared_ptr<MemoryNode>(make(std::move(left)));
+		new (&branch.right) shared_ptr<MemoryNode>(make(middle, last));
+		branch.weight = branch.left->size();
+		branch.counts = branch.left->counts();
+		return countText(first, last) - removed;
+	}
+	}
+	throw std::logic_error("It should never happen");
+}
+
+template<typename FORWARD_ITERATOR>
+inline TextCounts MemoryNode::insert(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
+	using namespace std;
+	TextCounts inserted;
+	switch (type) {
+	case BRANCH:
+		if (pos <= branch.weight) {
+			inserted = own(branch.left).insert(pos, first, last);
+			branch.weight += distance(first, last);
+			branch.counts += inserted;
+			return inserted;
+		}
+		return own(branch.right).insert(pos - branch.weight, first, last);
+	case MODIFIED_LEAF: {
+		auto &content = modified.content;
+		if (size_t(distance(first, last)) > content.room()) {
+			//Spreads over new chunks, with room to keep typing on any of them.
+			string text(content.data(), pos);
+			text.append(first, last);
+			text.append(content.data() + pos, content.size() - pos);
+			content.~TextChunk();
+			assign(text.begin(), text.end());
+		} else {
+			content.insert(pos, first, last);
+		}
+		return countText(first, last);
 	}
+	case ORIGINAL_LEAF:
+	case SPILLED_LEAF:
+	case SHARED_LEAF:
+		if (pos == size()) {
+			return replace(pos, first, last);
+		}
+		splitLeaf(pos);
+		inserted = own(branch.left).insert(pos, first, last);
+		branch.weight += distance(first, last);
+		branch.counts += inserted;
+		return inserted;
+	}
+	throw std::logic_error("It should never happen");
+}
+
+template<typename POSITION_ITERATOR, typename FORWARD_ITERATOR>
+inline TextCounts MemoryNode::insertAll(size_t base, POSITION_ITERATOR posFirst, POSITION_ITERATOR posLast,
+		FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
+	using namespace std;
+	TextCounts inserted;
+	if (type == BRANCH) {
+		size_t weight = branch.weight;
+		auto middle = upper_bound(posFirst, posLast, base + weight);
+		inserted = own(branch.right).insertAll(base + weight, middle, posLast, first, last);
+		TextCounts leftInserted = own(branch.left).insertAll(base, posFirst, middle, first, last);
+		branch.weight += distance(posFirst, middle) * distance(first, last);
+		branch.counts += leftInserted;
+		inserted += leftInserted;
+	} else {
+		//Back to front, so the earlier positions are still valid.
+		while (posLast != posFirst) {
+			inserted += insert(*--posLast - base, first, last);
+		}
+	}
+	return inserted;
+}
+
+inline TextCounts MemoryNode::erase(size_t pos, size_t count) {
+	using namespace std;
+	//TODO Remove node if it is empty
+	TextCounts erased;
+	switch (type) {
+	case BRANCH:
+		if (pos < branch.weight) {
+			auto leftCount = min(count, branch.weight - pos);
+			erased = own(branch.left).erase(pos, leftCount);
+			branch.weight -= leftCount;
+			branch.counts -= erased;
+			if (leftCount < count) {
+				erased += own(branch.right).erase(0, count - leftCount);
+			}
+			return erased;
+		}
+		return own(branch.right).erase(pos - branch.weight, count);
+	case ORIGINAL_LEAF:
+		if (pos == 0) {
+			auto diff = min(count, original.size);
+			erased = originalCounts(0, diff);
+			original.offset += diff;
+			original.size -= diff;
+		} else if (pos + count >= original.size) {
+			erased = originalCounts(pos, original.size);
+			original.size = pos;
+		} else {
+			splitLeaf(pos);
+			erased = own(branch.right).erase(0, count);
+		}
+		return erased;
 	case MODIFIED_LEAF: {
-		size_t foffset = target.tell();
-		size_t size = modified.content.size();
-		target.replace(modified.content.begin(), modified.content.end());
-		modified.content.~deque();
-		type = ORIGINAL_LEAF;
-		original.offset = foffset;
-		original.size = size;
+		auto &content = modified.content;
+		pos = min(pos, content.size());
+		count = min(count, content.size() - pos);
+		erased = modifiedCounts(pos, pos + count);
+		content.erase(pos, count);
+		return erased;
+	}
+	case SPILLED_LEAF:
+		if (pos == 0) {
+			auto diff = min(count, spilled.size);
+			erased = spilledCounts(0, diff);
+			if (!spilled.aliased) {
+				spilled.swap->release(spilled.offset, diff);
+			}
+			spilled.offset += diff;
+			spilled.size -= diff;
+		} else if (pos + count >= spilled.size) {
+			erased = spilledCounts(pos, spilled.size);
+			if (!spilled.aliased) {
+				spilled.swap->release(spilled.offset + pos, spilled.size - pos);
+			}
+			spilled.size = pos;
+		} else {
+			splitLeaf(pos);
+			return own(branch.right).erase(0, count);
+		}
+		spilled.counts -= erased;
+		return erased;
+	case SHARED_LEAF: {
+		auto data = shared.data.get();
+		if (pos == 0) {
+			auto diff = min(count, shared.size);
+			erased = countText(data, data + diff);
+			shared.data = shared_ptr<const char>(shared.data, data + diff);
+			shared.size -= diff;
+		} else if (pos + count >= shared.size) {
+			erased = countText(data + pos, data + shared.size);
+			shared.size = pos;
+		} else {
+			splitLeaf(pos);
+			return own(branch.right).erase(0, count);
+		}
+		shared.counts -= erased;
+		return erased;
+	}
+	}
+	throw std::logic_error("It should never happen");
+}
+
+inline TextCounts MemoryNode::insertShared(size_t pos, std::shared_ptr<const char> data, size_t size,
+		const MappedFile *file) {
+	auto first = data.get();
+	TextCounts counts = countText(first, first + size);
+	return splice(pos, make(std::move(data), size, counts, file));
+}
+
+template<typename RANGE_ITERATOR>
+inline TextCounts MemoryNode::eraseAll(size_t base, RANGE_ITERATOR rangeFirst, RANGE_ITERATOR rangeLast) {
+	using namespace std;
+	TextCounts erased;
+	if (type == BRANCH) {
+		size_t weight = branch.weight;
+		auto middle = find_if(rangeFirst, rangeLast, [&](auto const& range) {
+			return range.first + range.second > base + weight;
+		});
+		auto rightFirst = middle;
+		if (middle != rangeLast && middle->first < base + weight) {
+			++rightFirst;
+		}
+		size_t leftCount = 0;
+		TextCounts leftErased;
+		for (auto it = rangeFirst; it != middle; ++it) {
+			leftCount += it->second;
+		}
+		//Back to front, so the earlier positions are still valid.
+		erased = own(branch.right).eraseAll(base + weight, rightFirst, rangeLast);
+		if (rightFirst != middle) {
+			//The range crossing both sides.
+			size_t leftPart = base + weight - middle->first;
+			erased += own(branch.right).erase(0, middle->second - leftPart);
+			leftErased = own(branch.left).erase(middle->first - base, leftPart);
+			leftCount += leftPart;
+		}
+		leftErased += own(branch.left).eraseAll(base, rangeFirst, middle);
+		branch.weight -= leftCount;
+		branch.counts -= leftErased;
+		erased += leftErased;
+	} else {
+		//Back to front, so the earlier positions are still valid.
+		while (rangeLast != rangeFirst) {
+			--rangeLast;
+			erased += erase(rangeLast->first - base, rangeLast->second);
+		}
+	}
+	return erased;
+}
+
+inline size_t MemoryNode::flush(FileTarget& target, const LineIndex *index) {
+	using namespace std;
+	size_t written = 0;
+	vector<pair<size_t, MemoryNode*>> leaves;
+	allLeaves(0, leaves);
+	auto inPlace = inOrder(leaves);
+	target.flush();
+	int fd = target.descriptor();
+	//Where each of the other original leaves is staged, before anything is written.
+	unique_ptr<SwapFile> staging;
+	vector<size_t> staged(leaves.size(), npos);
+	for (size_t i = 0; i < leaves.size(); ++i) {
+		MemoryNode &node = *leaves[i].second;
+		if (node.type == ORIGINAL_LEAF && !inPlace[i] && node.original.size > 0) {
+			if (!staging) {
+				staging = make_unique<SwapFile>();
+			}
+			staged[i] = staging->appendRange(fd, node.original.offset, node.original.size);
+		}
+	}
+	for (size_t i = 0; i < leaves.size(); ++i) {
+		MemoryNode &node = *leaves[i].second;
+		if (inPlace[i] && leaves[i].first < node.original.offset) {
+			written += copyFileRange(fd, node.original.offset, fd, leaves[i].first, node.original.size);
+		}
+	}
+	for (size_t i = leaves.size(); i-- > 0;) {
+		MemoryNode &node = *leaves[i].second;
+		if (inPlace[i] && leaves[i].first > node.original.offset) {
+			written += copyFileRange(fd, node.original.offset, fd, leaves[i].first, node.original.size);
+		}
+	}
+	//Adjacent in memory content is gathered, so small leaves do not cost a write each.
+	string pending;
+	size_t pendingPos = 0;
+	auto write = [&](size_t pos, const char *first, const char *last) {
+		if (!pending.empty() && (pos != pendingPos + pending.size() || pending.size() >= FLUSH_BLOCK)) {
+			writeFileRange(fd, pendingPos, pending.data(), pending.size());
+			pending.clear();
+		}
+		if (pending.empty()) {
+			pendingPos = pos;
+		}
+		pending.append(first, last);
+		written += last - first;
+	};
+	for (size_t i = 0; i < leaves.size(); ++i) {
+		auto &leaf = leaves[i];
+		MemoryNode &node = *leaf.second;
+		if (staged[i] != npos) {
+			written += copyFileRange(staging->descriptor(), staged[i], fd, leaf.first, node.original.size);
+		} else if (node.type != ORIGINAL_LEAF) {
+			written += node.writeLeaf(leaf.first, fd, write);
+		}
+	}
+	if (!pending.empty()) {
+		writeFileRange(fd, pendingPos, pending.data(), pending.size());
+	}
+	target.toStart();
+	becomeOriginal(size(), index);
+	return written;
+}
+
+inline size_t MemoryNode::flushTo(int fd, const FileTarget& internalTarget, const LineIndex *index) {
+	using namespace std;
+	size_t written = 0;
+	vector<pair<size_t, MemoryNode*>> leaves;
+	allLeaves(0, leaves);
+	string pending;
+	size_t pendingPos = 0;
+	auto write = [&](size_t pos, const char *first, const char *last) {
+		if (!pending.empty() && (pos != pendingPos + pending.size() || pending.size() >= FLUSH_BLOCK)) {
+			writeFileRange(fd, pendingPos, pending.data(), pending.size());
+			pending.clear();
+		}
+		if (pending.empty()) {
+			pendingPos = pos;
+		}
+		pending.append(first, last);
+		written += last - first;
+	};
+	for (auto &leaf : leaves) {
+		MemoryNode &node = *leaf.second;
+		if (node.type != ORIGINAL_LEAF) {
+			written += node.writeLeaf(leaf.first, fd, write);
+			continue;
+		}
+		written += copyFileRange(internalTarget.descriptor(), node.original.offset, fd, leaf.first,
+				node.original.size);
+	}
+	if (!pending.empty()) {
+		writeFileRange(fd, pendingPos, pending.data(), pending.size());
+	}
+	becomeOriginal(size(), index);
+	return written;
+}
+
+template<typename WRITE>
+inline size_t MemoryNode::writeLeaf(size_t pos, int fd, WRITE &&write) const {
+	switch (type) {
+	case MODIFIED_LEAF:
+		modified.content.forEachSpan(0, modified.content.size(), [&](const char *first, const char *last) {
+			write(pos, first, last);
+			pos += last - first;
+			return true;
+		});
+		return 0;
+	case SPILLED_LEAF:
+		return copyFileRange(spilled.swap->descriptor(), spilled.offset, fd, pos, spilled.size);
+	case SHARED_LEAF:
+		if (shared.file) {
+			auto file = shared.file;
+			return copyFileRange(file->descriptor(), shared.data.get() - file->data(), fd, pos, shared.size);
+		} else if (shared.size < FLUSH_BLOCK) {
+			write(pos, shared.data.get(), shared.data.get() + shared.size);
+			return 0;
+		}
+		writeFileRange(fd, pos, shared.data.get(), shared.size);
+		return shared.size;
+	case BRANCH:
+	case ORIGINAL_LEAF:
 		break;
 	}
+	return 0;
+}
+
+inline void MemoryNode::becomeOriginal(size_t total, const LineIndex *index) {
+	switch (type) {
+	case BRANCH:
+		branch.left.~shared_ptr();
+		branch.right.~shared_ptr();
+		break;
+	case MODIFIED_LEAF:
+		modified.content.~TextChunk();
+		break;
+	case SHARED_LEAF:
+		shared.data.~shared_ptr();
+		break;
+	case ORIGINAL_LEAF:
+	case SPILLED_LEAF:
+		break;
+	}
+	type = ORIGINAL_LEAF;
+	original.offset = 0;
+	original.size = total;
+	original.index = index;
+}
+
+inline size_t MemoryNode::spill(SwapFile& swap, size_t pos, size_t budget) {
+	using namespace std;
+	vector<pair<size_t, MemoryNode*>> leaves;
+	ownedLeaves(0, leaves);
+	leaves.erase(remove_if(leaves.begin(), leaves.end(), [](auto const& leaf) {
+		return leaf.second->type != MODIFIED_LEAF;
+	}), leaves.end());
+	size_t resident = 0;
+	for (auto &leaf : leaves) {
+		resident += leaf.second->modified.content.size();
+	}
+	auto distance = [pos](pair<size_t, MemoryNode*> const& leaf) {
+		size_t first = leaf.first, last = first + leaf.second->modified.content.size();
+		return pos < first ? first - pos : pos > last ? pos - last : 0;
+	};
+	sort(leaves.begin(), leaves.end(), [&](auto const& a, auto const& b) {
+		return distance(a) > distance(b);
+	});
+	for (auto &leaf : leaves) {
+		if (resident <= budget) {
+			break;
+		}
+		MemoryNode &node = *leaf.second;
+		if (node.type != MODIFIED_LEAF || node.modified.content.size() < MIN_SPILL) {
+			continue;
+		}
+		auto &content = node.modified.content;
+		size_t size = content.size();
+		size_t offset = swap.append(content.begin(), content.end());
+		TextCounts counts = countText(content.begin(), content.end());
+		content.~TextChunk();
+		node.type = SPILLED_LEAF;
+		node.spilled.offset = offset;
+		node.spilled.size = size;
+		node.spilled.counts = counts;
+		node.spilled.swap = &swap;
+		node.spilled.aliased = false;
+		resident -= size;
+	}
+	return resident;
+}
+
+template<typename FORWARD_ITERATOR>
+inline void MemoryNode::assign(FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
+	using namespace std;
+	size_t count = distance(first, last);
+	if (count <= TextChunk::CAPACITY) {
+		type = MODIFIED_LEAF;
+		new (&modified.content) TextChunk(first, last);
+		return;
 	}
+	//Half of the chunks on each side, all filled alike, with room to grow.
+	size_t chunks = (count + FILL - 1) / FILL;
+	auto middle = next(first, count * (chunks / 2) / chunks);
+	type = BRANCH;
+	new (&branch.left) shared_ptr<MemoryNode>(make(first, middle));
+	new (&branch.right) shared_ptr<MemoryNode>(make(middle, last));
+	branch.weight = distance(first, middle);
+	branch.counts = branch.left->counts();
 }
 
-inline void MemoryNode::split(size_t pos) {
+inline void MemoryNode::splitLeaf(size_t pos) {
 	using namespace std;
 	switch (type) {
 	case BRANCH:
@@ -328,46 +1394,396 @@ inline void MemoryNode::split(size_t pos) {
 		auto first = original.offset;
 		auto middle = first + pos;
 		auto last = first + original.size;
+		auto index = original.index;
 		type = BRANCH;
-		new (&branch.left) unique_ptr<MemoryNode>(new MemoryNode(first, middle - first));
-		new (&branch.right) unique_ptr<MemoryNode>(new MemoryNode(middle, last - middle));
+		new (&branch.left) shared_ptr<MemoryNode>(make(first, middle - first, index));
+		new (&branch.right) shared_ptr<MemoryNode>(make(middle, last - middle, index));
 		branch.weight = middle - first;
+		branch.counts = branch.left->counts();
 		break;
 	}
 	case MODIFIED_LEAF: {
 		auto leftContent = move(modified.content);
-		deque<char> rightContent(leftContent.begin() + pos, leftContent.end());
-		leftContent.erase(leftContent.begin() + pos, leftContent.end());
-		size_t leftOriginalSize, rightOriginalSize;
-		if (pos > modified.originalSize) {
-			leftOriginalSize = modified.originalSize;
-			rightOriginalSize = 0;
-		} else {
-			leftOriginalSize = pos;
-			rightOriginalSize = modified.originalSize - pos;
-		}
-		modified.content.~deque();
+		TextChunk rightContent(leftContent.begin() + pos, leftContent.end());
+		leftContent.erase(pos, leftContent.size() - pos);
+		modified.content.~TextChunk();
 		type = BRANCH;
-		new (&branch.left) unique_ptr<MemoryNode>(new MemoryNode(move(leftContent), leftOriginalSize));
-		new (&branch.right) unique_ptr<MemoryNode>(new MemoryNode(move(rightContent), rightOriginalSize));
+		new (&branch.left) shared_ptr<MemoryNode>(make(move(leftContent)));
+		new (&branch.right) shared_ptr<MemoryNode>(make(move(rightContent)));
 		branch.weight = branch.left->modified.content.size();
+		branch.counts = branch.left->counts();
+		break;
+	}
+	case SPILLED_LEAF: {
+		auto swap = spilled.swap;
+		size_t first = spilled.offset, size = spilled.size;
+		bool aliased = spilled.aliased;
+		TextCounts counts = spilled.counts, leftCounts = countsBefore(pos);
+		type = BRANCH;
+		new (&branch.left) shared_ptr<MemoryNode>(make(swap, first, pos, leftCounts, aliased));
+		new (&branch.right) shared_ptr<MemoryNode>(
+				make(swap, first + pos, size - pos, counts - leftCounts, aliased));
+		branch.weight = pos;
+		branch.counts = leftCounts;
+		break;
+	}
+	case SHARED_LEAF: {
+		TextCounts counts = shared.counts, leftCounts = countsBefore(pos);
+		auto data = move(shared.data);
+		size_t size = shared.size;
+		auto file = shared.file;
+		shared.data.~shared_ptr();
+		type = BRANCH;
+		new (&branch.left) shared_ptr<MemoryNode>(make(data, pos, leftCounts, file));
+		new (&branch.right) shared_ptr<MemoryNode>(
+				make(shared_ptr<const char>(data, data.get() + pos), size - pos, counts - leftCounts, file));
+		branch.weight = pos;
+		branch.counts = leftCounts;
 		break;
 	}
 	}
 }
 
-inline ptrdiff_t MemoryNode::offset() const {
+inline TextCounts MemoryNode::splice(size_t pos, std::shared_ptr<MemoryNode> node) {
+	using namespace std;
+	if (type == BRANCH) {
+		if (pos <= branch.weight) {
+			size_t count = node->size();
+			TextCounts inserted = own(branch.left).splice(pos, move(node));
+			branch.weight += count;
+			branch.counts += inserted;
+			return inserted;
+		}
+		return own(branch.right).splice(pos - branch.weight, move(node));
+	}
+	if (pos > 0 && pos < size()) {
+		splitLeaf(pos);
+		return splice(pos, move(node));
+	}
+	TextCounts inserted = node->counts();
+	auto self = make(move(*this));
+	this->~MemoryNode();
+	if (pos == 0) {
+		new (this) MemoryNode(move(node), move(self));
+	} else {
+		new (this) MemoryNode(move(self), move(node));
+	}
+	return inserted;
+}
+
+inline TextCounts MemoryNode::insertTree(size_t pos, std::shared_ptr<MemoryNode> node) {
+	return splice(pos, std::move(node));
+}
+
+inline std::shared_ptr<MemoryNode> MemoryNode::split(size_t pos) {
+	auto self = make(std::move(*this));
+	this->~MemoryNode();
+	auto rest = splitOff(self, pos);
+	new (this) MemoryNode(std::move(own(self)));
+	return rest;
+}
+
+inline TextCounts MemoryNode::concat(std::shared_ptr<MemoryNode> other) {
+	if (other->size() == 0) {
+		return TextCounts { };
+	}
+	TextCounts appended = other->counts();
+	auto self = make(std::move(*this));
+	this->~MemoryNode();
+	auto joined = join(std::move(self), std::move(other));
+	new (this) MemoryNode(std::move(own(joined)));
+	return appended;
+}
+
+inline std::shared_ptr<MemoryNode> MemoryNode::splitOff(std::shared_ptr<MemoryNode> &node, size_t pos) {
+	using namespace std;
+	if (pos == 0) {
+		auto rest = move(node);
+		node = make(TextChunk());
+		return rest;
+	} else if (pos >= node->size()) {
+		return make(TextChunk());
+	}
+	MemoryNode &owned = own(node);
+	if (owned.type != BRANCH) {
+		owned.splitLeaf(pos);
+	}
+	if (pos > owned.branch.weight) {
+		//The left side and the counts of it are kept.
+		return splitOff(owned.branch.right, pos - owned.branch.weight);
+	}
+	auto rest = splitOff(owned.branch.left, pos);
+	auto right = owned.branch.right;
+	auto left = owned.branch.left;
+	node = move(left);
+	return join(move(rest), move(right));
+}
+
+inline std::shared_ptr<MemoryNode> MemoryNode::join(std::shared_ptr<MemoryNode> left,
+		std::shared_ptr<MemoryNode> right) {
+	if (left->size() == 0) {
+		return right;
+	} else if (right->size() == 0) {
+		return left;
+	}
+	return make(std::move(left), std::move(right));
+}
+
+inline std::shared_ptr<MemoryNode> MemoryNode::slice(size_t pos, size_t count) {
+	using namespace std;
+	pos = min(pos, size());
+	count = min(count, size() - pos);
+	if (type == SPILLED_LEAF) {
+		//Both trees refer to the range now.
+		spilled.aliased = true;
+	}
+	if (pos == 0 && count == size()) {
+		//The root itself is not shared, as it is not owned by a shared_ptr.
+		return make(*this);
+	}
+	if (type == BRANCH) {
+		if (pos + count <= branch.weight) {
+			return sliceOf(branch.left, pos, count);
+		} else if (pos >= branch.weight) {
+			return sliceOf(branch.right, pos - branch.weight, count);
+		}
+		size_t leftCount = branch.weight - pos;
+		return make(sliceOf(branch.left, pos, leftCount), sliceOf(branch.right, 0, count - leftCount));
+	}
 	switch (type) {
+	case ORIGINAL_LEAF:
+		return make(original.offset + pos, count, original.index);
+	case MODIFIED_LEAF: {
+		string text;
+		modified.content.forEachSpan(pos, count, [&text](const char *first, const char *last) {
+			text.append(first, last);
+			return true;
+		});
+		return make(text.begin(), text.end());
+	}
+	case SPILLED_LEAF:
+		return make(spilled.swap, spilled.offset + pos, count, spilledCounts(pos, pos + count), true);
+	case SHARED_LEAF: {
+		auto first = shared.data.get() + pos;
+		return make(shared_ptr<const char>(shared.data, first), count,
+				countText(first, first + count), shared.file);
+	}
 	case BRANCH:
-		return branch.left->offset() + branch.right->offset();
+		break;
+	}
+	throw std::logic_error("It should never happen");
+}
+
+inline std::shared_ptr<MemoryNode> MemoryNode::sliceOf(std::shared_ptr<MemoryNode> const& node, size_t pos,
+		size_t count) {
+	if (pos == 0 && count >= node->size()) {
+		if (node->type == SPILLED_LEAF) {
+			node->spilled.aliased = true;
+		}
+		return node;
+	}
+	return node->slice(pos, count);
+}
+
+inline void MemoryNode::relocate(std::shared_ptr<MemoryNode> &node, SwapFile& swap, const FileTarget& internalTarget) {
+	if (!node->needsRelocation(swap)) {
+		return;
+	}
+	if (node->type == BRANCH) {
+		MemoryNode &owned = own(node);
+		relocate(owned.branch.left, swap, internalTarget);
+		relocate(owned.branch.right, swap, internalTarget);
+		return;
+	}
+	//The old leaf is left to the trees still sharing it.
+	size_t offset, size = node->size();
+	bool counted = node->type != ORIGINAL_LEAF || node->original.index->complete();
+	TextCounts counts = counted ? node->counts() : TextCounts { };
+	if (node->type == ORIGINAL_LEAF) {
+		offset = swap.appendRange(internalTarget.descriptor(), node->original.offset, size);
+	} else {
+		offset = swap.appendRange(node->spilled.swap->descriptor(), node->spilled.offset, size);
+	}
+	auto relocated = make(&swap, offset, size, counts);
+	if (!counted) {
+		relocated->spilled.counts = relocated->spilledCounts(0, size);
+	}
+	node = std::move(relocated);
+}
+
+inline bool MemoryNode::needsRelocation(const SwapFile &swap) const {
+	switch (type) {
+	case BRANCH:
+		return branch.left->needsRelocation(swap) || branch.right->needsRelocation(swap);
 	case ORIGINAL_LEAF:
-		return 0;
+		return original.size > 0;
+	case SPILLED_LEAF:
+		return spilled.swap != &swap && spilled.size > 0;
 	case MODIFIED_LEAF:
-		return modified.content.size() - modified.originalSize;
+	case SHARED_LEAF:
+		return false;
 	}
 	throw std::logic_error("It should never happen");
 }
 
+inline MemoryNode& MemoryNode::own(std::shared_ptr<MemoryNode> &node) {
+	if (node.use_count() > 1) {
+		if (node->type == SPILLED_LEAF) {
+			//The other trees keep referring to the range.
+			node->spilled.aliased = true;
+		}
+		node = make(*node);
+	}
+	return *node;
+}
+
+inline TextCounts MemoryNode::originalCounts(size_t first, size_t last) const {
+	first += original.offset;
+	last += original.offset;
+	auto counts = original.index->counts(first, last);
+	return {ptrdiff_t(counts.first), ptrdiff_t(counts.second)};
+}
+
+inline TextCounts MemoryNode::spilledCounts(size_t first, size_t last) const {
+	TextCounts counts;
+	scanSpilled(first, last, [&counts](size_t, const char *first, const char *last) {
+		counts += countText(first, last);
+		return true;
+	});
+	return counts;
+}
+
+inline TextCounts MemoryNode::modifiedCounts(size_t first, size_t last) const {
+	TextCounts counts;
+	modified.content.forEachSpan(first, last - std::min(first, last), [&counts](const char *first, const char *last) {
+		counts += countText(first, last);
+		return true;
+	});
+	return counts;
+}
+
+inline size_t MemoryNode::readLeaf(size_t pos, size_t count, char* buffer, const FileTarget& internalTarget) const {
+	if (type == SPILLED_LEAF) {
+		return spilled.swap->readRange(spilled.offset + pos, count, buffer);
+	}
+	return internalTarget.readRange(original.offset + pos, count, buffer);
+}
+
+template<typename FUNCTION>
+inline void MemoryNode::scanSpilled(size_t first, size_t last, FUNCTION&& fn) const {
+	constexpr size_t BLOCK_SIZE = 64 * 1024;
+	std::unique_ptr<char[]> buffer(new char[std::min(last - first, BLOCK_SIZE)]);
+	while (first < last) {
+		size_t read = spilled.swap->readRange(spilled.offset + first, std::min(last - first, BLOCK_SIZE), buffer.get());
+		if (read == 0 || !fn(first, (const char *) buffer.get(), (const char *) buffer.get() + read)) {
+			break;
+		}
+		first += read;
+	}
+}
+
+inline std::vector<bool> MemoryNode::inOrder(std::vector<std::pair<size_t, MemoryNode*>> const& leaves) {
+	using namespace std;
+	auto offset = [&leaves](size_t i) {
+		return leaves[i].second->original.offset;
+	};
+	//The longest increasing run of offsets, by patience sorting.
+	vector<size_t> tails, previous(leaves.size(), npos);
+	for (size_t i = 0; i < leaves.size(); ++i) {
+		auto &node = *leaves[i].second;
+		if (node.type != ORIGINAL_LEAF || node.original.size == 0) {
+			continue;
+		}
+		auto tail = lower_bound(tails.begin(), tails.end(), node.original.offset, [&](size_t j, size_t value) {
+			return offset(j) < value;
+		});
+		previous[i] = tail == tails.begin() ? npos : *(tail - 1);
+		if (tail == tails.end()) {
+			tails.push_back(i);
+		} else {
+			*tail = i;
+		}
+	}
+	vector<bool> result(leaves.size(), false);
+	for (size_t i = tails.empty() ? npos : tails.back(); i != npos; i = previous[i]) {
+		result[i] = true;
+	}
+	//Ranges pasted more than once overlap, so only the first is kept.
+	size_t end = 0;
+	for (size_t i = 0; i < leaves.size(); ++i) {
+		if (result[i] && offset(i) < end) {
+			result[i] = false;
+		} else if (result[i]) {
+			end = offset(i) + leaves[i].second->original.size;
+		}
+	}
+	return result;
+}
+
+inline NodeStats MemoryNode::stats() const {
+	NodeStats stats;
+	collectStats(stats, 1);
+	return stats;
+}
+
+inline size_t MemoryNode::allocations() {
+	return allocated.load(std::memory_order_relaxed);
+}
+
+template<typename... ARGS>
+inline std::shared_ptr<MemoryNode> MemoryNode::make(ARGS&&... args) {
+	allocated.fetch_add(1, std::memory_order_relaxed);
+	return std::shared_ptr<MemoryNode>(new MemoryNode(std::forward<ARGS>(args)...));
+}
+
+inline void MemoryNode::collectStats(NodeStats& stats, size_t depth) const {
+	stats.depth = std::max(stats.depth, depth);
+	switch (type) {
+	case BRANCH:
+		++stats.branches;
+		branch.left->collectStats(stats, depth + 1);
+		branch.right->collectStats(stats, depth + 1);
+		break;
+	case ORIGINAL_LEAF:
+		++stats.originalLeaves;
+		break;
+	case MODIFIED_LEAF:
+		++stats.modifiedLeaves;
+		stats.modifiedBytes += modified.content.size();
+		break;
+	case SPILLED_LEAF:
+		++stats.spilledLeaves;
+		stats.spilledBytes += spilled.size;
+		break;
+	case SHARED_LEAF:
+		++stats.sharedLeaves;
+		stats.sharedBytes += shared.size;
+		break;
+	}
+}
+
+inline void MemoryNode::allLeaves(size_t base, std::vector<std::pair<size_t, MemoryNode*>>& leaves) {
+	if (type == BRANCH) {
+		branch.left->allLeaves(base, leaves);
+		branch.right->allLeaves(base + branch.weight, leaves);
+	} else {
+		leaves.emplace_back(base, this);
+	}
+}
+
+inline void MemoryNode::ownedLeaves(size_t base, std::vector<std::pair<size_t, MemoryNode*>>& leaves) {
+	if (type != BRANCH) {
+		leaves.emplace_back(base, this);
+		return;
+	}
+	if (branch.left.use_count() == 1) {
+		branch.left->ownedLeaves(base, leaves);
+	}
+	if (branch.right.use_count() == 1) {
+		branch.right->ownedLeaves(base + branch.weight, leaves);
+	}
+}
+
 }
 
 #endif /* SRC_MEMORYNODE_HPP_ */
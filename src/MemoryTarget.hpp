@@ -9,25 +9,83 @@
 #define SWEET_MEMORYTARGET_HPP_
 
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
 #include <cstddef>
 #include <cstdint>
-#include <deque>
+#include <cstdlib>
+#include <cstring>
 #include <iterator>
+#include <map>
 #include <memory>
+#include <ostream>
+#include <stdexcept>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CursorSet.hpp"
 #include "FileTarget.hpp"
+#include "Journal.hpp"
+#include "LineIndex.hpp"
+#include "MappedFile.hpp"
+#include "MemoryIterator.hpp"
 #include "MemoryNode.hpp"
+#include "SwapFile.hpp"
 #include "TargetTraits.hpp"
 
 namespace sweet {
 
 /**
  * Represents a target in-memory.
+ *
+ * Opening does not read the file. It is indexed on the background, so the
+ * first screen can be shown at once; the queries wait only for the index of
+ * the region they touch. The totals, like lines() and codepoints(), wait
+ * for the whole index.
  */
 class MemoryTarget {
 public:
 	using category = insertable_target_tag;
+	using const_iterator = MemoryIterator;
+
+	/**
+	 * How the edits are kept.
+	 */
+	struct Options {
+		/**
+		 * If the edits are recorded on filename + ".journal" until flushed.
+		 * The ones left there by a previous session that did not flush are
+		 * replayed first. The flush then writes a new file and renames it
+		 * over the target, instead of rewriting it in place, so a crash
+		 * midway leaves both the target and the journal as they were.
+		 */
+		bool journal = false;
+		/// When the journal is synced to the disc.
+		Journal::Sync sync = Journal::Sync::PERIODIC;
+		/// How much modified content is kept in memory, zero for no limit.
+		size_t memoryBudget = 0;
+		/// Where the journal records that can not be replayed are told, if anywhere.
+		std::ostream *log = nullptr;
+	};
+
+	/**
+	 * What the target is made of and did, to diagnose slow sessions.
+	 */
+	struct Stats {
+		NodeStats tree;           ///< the tree, as it is now.
+		size_t originalReads;     ///< reads of the target file, each a seek, the indexing included.
+		size_t originalBytesRead; ///< characters read from the target file, the indexing included.
+		size_t flushes;
+		size_t flushedBytes;      ///< characters written by the flushes, the moved original ones included.
+		size_t nodeAllocations;   ///< nodes allocated by the process, for all targets.
+		size_t chunkAllocations;  ///< text chunk buffers allocated by the process, for all targets.
+	};
 public:
 	/**
 	 * @brief Ctor
@@ -35,6 +93,18 @@ public:
 	 */
 	MemoryTarget(std::string const& filename);
 
+	/**
+	 * @brief Ctor with options
+	 * @param filename
+	 * @param options
+	 */
+	MemoryTarget(std::string const& filename, Options const& options);
+
+	/**
+	 * Dtor. Stops the indexing.
+	 */
+	~MemoryTarget();
+
 	/**
 	 * @brief Returns a view.
 	 * @param count the max number of characters.
@@ -56,6 +126,28 @@ public:
 	template<typename OUTPUT_ITERATOR>
 	void viewAll(OUTPUT_ITERATOR&& out) const;
 
+	/**
+	 * @brief Calls fn(first, last) for every contiguous segment of a range.
+	 * @param pos
+	 * @param count
+	 * @param fn receives a pair of iterators and returns false to stop.
+	 * @return false if it was stopped by fn.
+	 */
+	template<typename FUNCTION>
+	bool forEachSegment(size_t pos, size_t count, FUNCTION &&fn) const;
+
+	/**
+	 * @brief Iterator to the first character.
+	 *
+	 * Iterators are invalidated by any modification.
+	 */
+	const_iterator begin() const;
+
+	/**
+	 * @brief Iterator past the last character.
+	 */
+	const_iterator end() const;
+
 	/**
 	 * @brief Tells the number of characters.
 	 * @return the size
@@ -83,6 +175,60 @@ public:
 	template<typename FORWARD_ITERATOR>
 	void insert(FORWARD_ITERATOR first, FORWARD_ITERATOR last);
 
+	/**
+	 * @brief Inserts a value on current position, taking it over instead of copying.
+	 *
+	 * A value larger than a few KB becomes a leaf of its own; smaller ones
+	 * are copied, as insert(first, last).
+	 * @param value what to insert.
+	 */
+	void insert(std::string &&value);
+
+	/**
+	 * @copydoc insert(std::string&&)
+	 */
+	void insert(std::vector<char> &&value);
+
+	/**
+	 * @brief Inserts a shared value on current position, without copying it.
+	 * @param value what to insert. It must not change while the target uses it,
+	 * that is, until the next flush.
+	 */
+	void insert(std::shared_ptr<const std::string> value);
+
+	/**
+	 * @brief Inserts a range of another file on current position, by reference.
+	 *
+	 * The file is mapped read only, so it is not loaded into memory; it
+	 * is read once, to count its lines and codepoints, and only copied on
+	 * flush. It must not be changed until then. The journal keeps its
+	 * absolute path and stamp, so the insertion is dropped from the replay
+	 * if it changed or went away.
+	 * @param path
+	 * @param offset where the range starts, clamped to the file size.
+	 * @param length the range length, clamped to the file size.
+	 */
+	void insertFile(std::string const& path, size_t offset = 0, size_t length = size_t(-1));
+
+	/**
+	 * @brief Replace the content on current position, taking the value over instead of copying.
+	 * @param value value to replace
+	 *
+	 * As replace(first, last), it advances the position over the value.
+	 */
+	void replace(std::string &&value);
+
+	/**
+	 * @copydoc replace(std::string&&)
+	 */
+	void replace(std::vector<char> &&value);
+
+	/**
+	 * @brief Replace the content on current position with a shared value, without copying it.
+	 * @param value value to replace. It must not change until the next flush.
+	 */
+	void replace(std::shared_ptr<const std::string> value);
+
 	/**
 	 * Erase characters
 	 * @param count the quantity to erase.
@@ -90,6 +236,78 @@ public:
 	 */
 	void erase(size_t count);
 
+	/**
+	 * @brief Inserts a value on every cursor.
+	 *
+	 * The whole batch is done in a single walk of the tree. Each cursor
+	 * ends up after the text inserted on it.
+	 */
+	template<typename FORWARD_ITERATOR>
+	void insertAtCursors(FORWARD_ITERATOR first, FORWARD_ITERATOR last);
+
+	/**
+	 * @brief Erase characters after every cursor.
+	 * @param count the quantity to erase on each cursor.
+	 *
+	 * The erased ranges are clipped so they do not overlap the next
+	 * cursor. The whole batch is done in a single walk of the tree.
+	 */
+	void eraseAtCursors(size_t count);
+
+	/**
+	 * @brief Moves a range to another place.
+	 *
+	 * The range is cut off the tree and spliced back in, so no content is
+	 * copied and it takes O(log n) however large the range is. The flush
+	 * then writes it only once, at its final place. Cursors inside the range
+	 * are left at its old place, and the position ends after its new place.
+	 * @param pos where the range starts.
+	 * @param count the range size.
+	 * @param destination where it goes, as a position before the move. If
+	 * it is inside the range, nothing is moved.
+	 */
+	void move(size_t pos, size_t count, size_t destination);
+
+	/**
+	 * @brief Copies characters from the current position to a register.
+	 *
+	 * The register shares the content with the target, so copying takes
+	 * no time nor memory proportional to count. It keeps its content
+	 * whatever is done on the target, flushes included.
+	 * @param count the quantity to copy.
+	 * @param name the register, replacing what it had.
+	 */
+	void copy(size_t count, char name = DEFAULT_REGISTER);
+
+	/**
+	 * @brief Copies characters from the current position to a register, then erases them.
+	 * @param count the quantity to cut.
+	 * @param name the register, replacing what it had.
+	 */
+	void cut(size_t count, char name = DEFAULT_REGISTER);
+
+	/**
+	 * @brief Inserts the content of a register on current position.
+	 *
+	 * The content is shared, not copied, so it takes no time proportional
+	 * to its size. Pasting an empty register does nothing.
+	 * @param name the register.
+	 */
+	void paste(char name = DEFAULT_REGISTER);
+
+	/**
+	 * @brief Tells the number of characters on a register.
+	 */
+	size_t registerSize(char name = DEFAULT_REGISTER) const;
+
+	/// The register used when none is given.
+	static constexpr char DEFAULT_REGISTER = '"';
+
+	/**
+	 * @brief Writes the edits to the file.
+	 *
+	 * In place, or through a new file renamed over it if journaled.
+	 */
 	void flush();
 
 	/**
@@ -113,18 +331,285 @@ public:
 	 * @param offset the number of character to advance. May be negative.
 	 */
 	void go(ptrdiff_t offset);
+
+	/**
+	 * @brief Tells the number of lines.
+	 *
+	 * It is always one more than the number of newlines.
+	 */
+	size_t lines() const;
+
+	/**
+	 * @brief Tells the line of the current position, zero based.
+	 */
+	size_t line() const;
+
+	/**
+	 * @brief Where a line starts.
+	 * @param line zero based.
+	 * @return the position or size() if there is no such line.
+	 */
+	size_t lineStart(size_t line) const;
+
+	/**
+	 * @brief Goes to the start of a line.
+	 * @param line zero based. If too large goes to the last line.
+	 */
+	void goLine(size_t line);
+
+	/**
+	 * @brief Tells if there is such line.
+	 *
+	 * Unlike comparing with lines(), it waits only for the index up to it.
+	 * @param line zero based.
+	 */
+	bool hasLine(size_t line) const;
+
+	/**
+	 * @brief Tells the number of UTF-8 codepoints.
+	 *
+	 * Every byte that is not a continuation byte counts as one, so
+	 * invalid sequences still have a definite count.
+	 */
+	size_t codepoints() const;
+
+	/**
+	 * @brief Tells the codepoint containing the current position, zero based.
+	 */
+	size_t codepoint() const;
+
+	/**
+	 * @brief Where a codepoint starts.
+	 * @param nth zero based.
+	 * @return the position or size() if there is no such codepoint.
+	 */
+	size_t codepointStart(size_t nth) const;
+
+	/**
+	 * @brief Advances the position by codepoints.
+	 *
+	 * The position always ends on a codepoint start, clamped to the content.
+	 * @param offset the number of codepoints to advance. May be negative.
+	 */
+	void goCodepoints(ptrdiff_t offset);
+
+	/**
+	 * @brief Erase codepoints.
+	 *
+	 * The position is first moved to the start of its codepoint, so no
+	 * sequence is left broken.
+	 * @param count the quantity to erase.
+	 */
+	void eraseCodepoints(size_t count);
+
+	/**
+	 * @brief Tells if the content, as loaded or last flushed, is valid UTF-8.
+	 */
+	bool utf8() const;
+
+	/**
+	 * @brief Detects the encoding of the content, as loaded or last flushed.
+	 */
+	Encoding encoding() const;
+
+	/**
+	 * @brief Tells if the content is fully indexed, so no query blocks.
+	 */
+	bool indexed() const;
+
+	/**
+	 * @brief Limits the modified content kept in memory.
+	 *
+	 * Above it the modified leaves farthest from the position are moved to a
+	 * swap file, where they are read from, as the original content is from
+	 * the target. Leaves smaller than a page always stay in memory.
+	 * @param bytes zero for no limit, the default.
+	 */
+	void setMemoryBudget(size_t bytes);
+
+	/**
+	 * @brief Tells how much modified content is in memory, at most.
+	 */
+	size_t residentSize() const;
+
+	/**
+	 * @brief Adds a cursor on the current position.
+	 *
+	 * Cursors follow the edits made before them.
+	 */
+	void addCursor();
+
+	/**
+	 * @brief Adds a cursor.
+	 * @param pos
+	 */
+	void addCursor(size_t pos);
+
+	/**
+	 * @brief Removes all cursors
+	 */
+	void clearCursors();
+
+	/**
+	 * @brief The cursors
+	 */
+	CursorSet const& cursors() const;
+
+	/**
+	 * @brief Tells the counters. It walks the whole tree.
+	 */
+	Stats stats() const;
+private:
+	/**
+	 * Indexes the original content on the background.
+	 */
+	void startIndexing();
+
+	/**
+	 * Waits the indexing to finish.
+	 */
+	void finishIndexing();
+
+	/**
+	 * The counts of the whole content. Waits for the whole index.
+	 */
+	TextCounts counts() const;
+
+	/**
+	 * Writes the content to a new file beside the target, synced, and
+	 * renames it over the target, which is then reopened.
+	 * @return how many characters were written.
+	 */
+	size_t flushReplacing();
+
+	/**
+	 * Accounts for grown modified content, spilling if over the budget.
+	 */
+	void grown(size_t count);
+
+	/**
+	 * Inserts a buffer, owned by data, as a leaf.
+	 *
+	 * If it maps a file, path, it is journaled by reference, with the file stamp.
+	 */
+	void insertShared(std::shared_ptr<const char> data, size_t count, const MappedFile *file = nullptr,
+			std::string const& path = std::string(), Journal::Stamp stamp = Journal::Stamp { });
+
+	/**
+	 * Replaces with a buffer, owned by data, as a leaf.
+	 */
+	void replaceShared(std::shared_ptr<const char> data, size_t count);
+
+	/**
+	 * Wraps an adopted container as a buffer, sharing its ownership.
+	 */
+	template<typename CONTAINER>
+	static std::shared_ptr<const char> adopt(CONTAINER &&value);
+
+	/// The smallest value that is adopted instead of copied.
+	static constexpr size_t MIN_SHARED = TextChunk::CAPACITY;
+
 private:
+	std::string filename;
 	FileTarget internalTarget;
+	LineIndex lineIndex;
+	std::atomic<bool> stop { false };
+	std::thread indexer;
 	size_t position, size_, originalSize;
+	/// What the edits changed on the counts of the original content.
+	TextCounts edited;
+	/// The journal of the edits not flushed, if any.
+	std::unique_ptr<Journal> journal;
+	/// The modified content limit, zero for none, and an upper bound of what is in memory.
+	size_t memoryBudget = 0, resident = 0;
+	size_t flushes = 0, flushedBytes = 0;
+	std::unique_ptr<SwapFile> swap;
 	std::unique_ptr<MemoryNode> parent;
+	/// The copied content, sharing the nodes of the target.
+	std::map<char, std::shared_ptr<MemoryNode>> registers;
+	/// Where the register content the target file and the swap refer to goes on flush.
+	std::unique_ptr<SwapFile> clipboard;
+	CursorSet cursors_;
 };
 
 inline MemoryTarget::MemoryTarget(std::string const& filename) :
-		internalTarget(filename), position(0) {
+		filename(filename), internalTarget(filename), position(0) {
 	internalTarget.toEnd();
 	originalSize = size_ = internalTarget.tell();
 	internalTarget.toStart();
-	parent = std::make_unique<MemoryNode>(position, size_);
+	parent = std::make_unique<MemoryNode>(position, size_, &lineIndex);
+	startIndexing();
+}
+
+inline MemoryTarget::MemoryTarget(std::string const& filename, Options const& options) :
+		MemoryTarget(filename) {
+	setMemoryBudget(options.memoryBudget);
+	if (!options.journal) {
+		return;
+	}
+	//Replayed before it is set, so the edits are not recorded again.
+	auto replayed = std::make_unique<Journal>(filename + ".journal", filename, options.sync);
+	replayed->replay([this, &options](Journal::Operation operation, size_t pos, size_t count, const char *content) {
+		position = std::min(pos, size_);
+		switch (operation) {
+		case Journal::Operation::INSERT:
+			insert(content, content + count);
+			break;
+		case Journal::Operation::ERASE:
+			erase(count);
+			break;
+		case Journal::Operation::REPLACE:
+			replace(content, content + count);
+			break;
+		case Journal::Operation::INSERT_FILE: {
+			uint64_t values[4];
+			if (count < sizeof(values)) {
+				if (options.log) {
+					*options.log << "Truncated insertion not replayed" << std::endl;
+				}
+				break;
+			}
+			memcpy(values, content, sizeof(values));
+			std::string source(content + sizeof(values), count - sizeof(values));
+			//A source changed since would insert other content, so the record is dropped.
+			struct stat status;
+			if (stat(source.c_str(), &status) < 0
+					|| !(Journal::stamp(status) == Journal::Stamp { values[2], int64_t(values[3]) })) {
+				if (options.log) {
+					*options.log << "Insertion of '" << source << "' not replayed, as it changed" << std::endl;
+				}
+				break;
+			}
+			try {
+				insertFile(source, values[0], values[1]);
+			} catch (std::exception const& e) {
+				if (options.log) {
+					*options.log << "Insertion of '" << source << "' not replayed: " << e.what() << std::endl;
+				}
+			}
+			break;
+		}
+		case Journal::Operation::MOVE: {
+			uint64_t values[2];
+			if (count < sizeof(values)) {
+				if (options.log) {
+					*options.log << "Truncated move not replayed" << std::endl;
+				}
+				break;
+			}
+			memcpy(values, content, sizeof(values));
+			move(pos, values[0], values[1]);
+			break;
+		}
+		}
+	});
+	position = 0;
+	journal = std::move(replayed);
+}
+
+inline MemoryTarget::~MemoryTarget() {
+	stop = true;
+	finishIndexing();
 }
 
 /**
@@ -154,6 +639,19 @@ inline void MemoryTarget::viewAll(OUTPUT_ITERATOR&& out) const {
 	viewRange(0, size_, out);
 }
 
+template<typename FUNCTION>
+inline bool MemoryTarget::forEachSegment(size_t pos, size_t count, FUNCTION&& fn) const {
+	return parent->forEachSegment(pos, count, fn, internalTarget);
+}
+
+inline MemoryTarget::const_iterator MemoryTarget::begin() const {
+	return const_iterator(parent.get(), &internalTarget, 0);
+}
+
+inline MemoryTarget::const_iterator MemoryTarget::end() const {
+	return const_iterator(parent.get(), &internalTarget, size_);
+}
+
 inline size_t MemoryTarget::size() const {
 	return size_;
 }
@@ -167,7 +665,12 @@ inline size_t MemoryTarget::size() const {
  */
 template<typename FORWARD_ITERATOR>
 inline void MemoryTarget::replace(FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
-	parent->replace(position, first, last);
+	if (journal) {
+		journal->replace(position, first, last);
+		journal->commit();
+	}
+	edited += parent->replace(position, first, last);
+	grown(std::distance(first, last));
 	position += std::distance(first, last);
 	if (position > size_) {
 		size_ = position;
@@ -184,25 +687,320 @@ inline void MemoryTarget::replace(FORWARD_ITERATOR first, FORWARD_ITERATOR last)
  */
 template<typename FORWARD_ITERATOR>
 inline void MemoryTarget::insert(FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
-	parent->insert(position, first, last);
+	if (journal) {
+		journal->insert(position, first, last);
+		journal->commit();
+	}
+	edited += parent->insert(position, first, last);
 	auto incr = std::distance(first, last);
+	grown(incr);
+	cursors_.shift(position, incr);
 	position += incr;
 	size_ += incr;
 }
 
+inline void MemoryTarget::insert(std::string&& value) {
+	size_t count = value.size();
+	insertShared(adopt(std::move(value)), count);
+}
+
+inline void MemoryTarget::insert(std::vector<char>&& value) {
+	size_t count = value.size();
+	insertShared(adopt(std::move(value)), count);
+}
+
+inline void MemoryTarget::insert(std::shared_ptr<const std::string> value) {
+	size_t count = value->size();
+	insertShared(std::shared_ptr<const char>(value, value->data()), count);
+}
+
+inline void MemoryTarget::insertFile(std::string const& path, size_t offset, size_t length) {
+	auto file = std::make_shared<const MappedFile>(path, false);
+	offset = std::min(offset, file->size());
+	length = std::min(length, file->size() - offset);
+	if (length == 0) {
+		return;
+	}
+	struct stat source, target;
+	if (fstat(file->descriptor(), &source) < 0 || (fstat(internalTarget.descriptor(), &target) == 0
+			&& source.st_dev == target.st_dev && source.st_ino == target.st_ino)) {
+		//Flushing would change it under the mapping, so it is copied.
+		insert(std::string(file->data() + offset, length));
+		return;
+	}
+	//Journaled by the absolute path, as it may be replayed from another directory.
+	std::unique_ptr<char, decltype(&free)> absolute(realpath(path.c_str(), nullptr), &free);
+	auto mapping = file.get();
+	insertShared(std::shared_ptr<const char>(file, file->data() + offset), length, mapping,
+			absolute ? absolute.get() : path, Journal::stamp(source));
+}
+
+inline void MemoryTarget::replace(std::string&& value) {
+	size_t count = value.size();
+	replaceShared(adopt(std::move(value)), count);
+}
+
+inline void MemoryTarget::replace(std::vector<char>&& value) {
+	size_t count = value.size();
+	replaceShared(adopt(std::move(value)), count);
+}
+
+inline void MemoryTarget::replace(std::shared_ptr<const std::string> value) {
+	size_t count = value->size();
+	replaceShared(std::shared_ptr<const char>(value, value->data()), count);
+}
+
 inline void MemoryTarget::erase(size_t count) {
-	parent->erase(position, count);
+	count = std::min(count, size_ - position);
+	if (journal) {
+		journal->erase(position, count);
+		journal->commit();
+	}
+	edited -= parent->erase(position, count);
+	cursors_.collapse(position, count);
 	size_ -= count;
 }
 
+template<typename FORWARD_ITERATOR>
+inline void MemoryTarget::insertAtCursors(FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
+	if (cursors_.empty()) {
+		return;
+	}
+	auto positions = cursors_.positions();
+	if (journal) {
+		//Back to front, so each position is still valid when replayed.
+		for (auto pos = positions.rbegin(); pos != positions.rend(); ++pos) {
+			journal->insert(*pos, first, last);
+		}
+		journal->commit();
+	}
+	edited += parent->insertAll(0, positions.begin(), positions.end(), first, last);
+	size_t incr = std::distance(first, last);
+	grown(positions.size() * incr);
+	position += cursors_.lowerBound(position + 1) * incr;
+	for (size_t i = 0; i < positions.size(); ++i) {
+		positions[i] += (i + 1) * incr;
+	}
+	cursors_.assign(positions);
+	size_ += positions.size() * incr;
+}
+
+inline void MemoryTarget::eraseAtCursors(size_t count) {
+	if (cursors_.empty()) {
+		return;
+	}
+	auto positions = cursors_.positions();
+	std::vector<std::pair<size_t, size_t>> ranges;
+	ranges.reserve(positions.size());
+	for (size_t i = 0; i < positions.size(); ++i) {
+		size_t limit = i + 1 < positions.size() ? positions[i + 1] : size_;
+		size_t clipped = std::min(count, limit - positions[i]);
+		if (clipped > 0) {
+			ranges.emplace_back(positions[i], clipped);
+		}
+	}
+	if (journal) {
+		for (auto range = ranges.rbegin(); range != ranges.rend(); ++range) {
+			journal->erase(range->first, range->second);
+		}
+		journal->commit();
+	}
+	edited -= parent->eraseAll(0, ranges.begin(), ranges.end());
+	size_t erased = 0, erasedBefore = 0;
+	auto range = ranges.begin();
+	for (auto &pos : positions) {
+		while (range != ranges.end() && range->first < pos) {
+			erased += range->second;
+			++range;
+		}
+		pos -= erased;
+	}
+	for (; range != ranges.end(); ++range) {
+		erased += range->second;
+	}
+	for (auto &range : ranges) {
+		if (range.first < position) {
+			erasedBefore += std::min(range.second, position - range.first);
+		}
+	}
+	position -= erasedBefore;
+	cursors_.assign(positions);
+	size_ -= erased;
+}
+
+inline void MemoryTarget::move(size_t pos, size_t count, size_t destination) {
+	pos = std::min(pos, size_);
+	count = std::min(count, size_ - pos);
+	destination = std::min(destination, size_);
+	if (count == 0 || (destination >= pos && destination <= pos + count)) {
+		return;
+	}
+	if (journal) {
+		journal->move(pos, count, destination);
+		journal->commit();
+	}
+	//Where it goes once it is cut off.
+	if (destination > pos) {
+		destination -= count;
+	}
+	auto range = parent->split(pos);
+	parent->concat(range->split(count));
+	parent->insertTree(destination, std::move(range));
+	cursors_.collapse(pos, count);
+	cursors_.shift(destination, count);
+	position = destination + count;
+}
+
+inline void MemoryTarget::copy(size_t count, char name) {
+	registers[name] = parent->slice(position, count);
+}
+
+inline void MemoryTarget::cut(size_t count, char name) {
+	copy(count, name);
+	erase(count);
+}
+
+inline void MemoryTarget::paste(char name) {
+	auto it = registers.find(name);
+	if (it == registers.end() || it->second->size() == 0) {
+		return;
+	}
+	auto node = it->second;
+	size_t count = node->size();
+	if (journal) {
+		size_t pos = position;
+		node->forEachSegment(0, count, [&](const char *first, const char *last) {
+			journal->insert(pos, first, last);
+			pos += last - first;
+			return true;
+		}, internalTarget);
+		journal->commit();
+	}
+	edited += parent->insertTree(position, std::move(node));
+	cursors_.shift(position, count);
+	position += count;
+	size_ += count;
+}
+
+inline size_t MemoryTarget::registerSize(char name) const {
+	auto it = registers.find(name);
+	return it == registers.end() ? 0 : it->second->size();
+}
+
+inline void MemoryTarget::insertShared(std::shared_ptr<const char> data, size_t count, const MappedFile *file,
+		std::string const& path, Journal::Stamp stamp) {
+	auto first = data.get();
+	if (count < MIN_SHARED) {
+		insert(first, first + count);
+		return;
+	}
+	if (journal && file) {
+		journal->insertFile(position, path, first - file->data(), count, stamp);
+		journal->commit();
+	} else if (journal) {
+		journal->insert(position, first, first + count);
+		journal->commit();
+	}
+	edited += parent->insertShared(position, std::move(data), count, file);
+	cursors_.shift(position, count);
+	position += count;
+	size_ += count;
+}
+
+inline void MemoryTarget::replaceShared(std::shared_ptr<const char> data, size_t count) {
+	auto first = data.get();
+	if (count < MIN_SHARED) {
+		replace(first, first + count);
+		return;
+	}
+	if (journal) {
+		journal->replace(position, first, first + count);
+		journal->commit();
+	}
+	size_t overlap = std::min(count, size_ - position);
+	edited -= parent->erase(position, overlap);
+	edited += parent->insertShared(position, std::move(data), count);
+	position += count;
+	size_ += count - overlap;
+}
+
+template<typename CONTAINER>
+inline std::shared_ptr<const char> MemoryTarget::adopt(CONTAINER&& value) {
+	auto owner = std::make_shared<const typename std::decay<CONTAINER>::type>(std::move(value));
+	return std::shared_ptr<const char>(owner, owner->data());
+}
+
 inline void MemoryTarget::flush() {
-	internalTarget.toStart();
-	parent->flush(internalTarget);
-	if(size() < originalSize){
-		internalTarget.go(size() - internalTarget.tell());
-		internalTarget.shrink();
+	//The indexer reads the file, so it must be done before any write. It
+	//is stopped, as the index is rebuilt afterwards anyway.
+	stop = true;
+	finishIndexing();
+	stop = false;
+	if (!registers.empty() && !clipboard) {
+		clipboard = std::make_unique<SwapFile>();
+	}
+	for (auto &reg : registers) {
+		MemoryNode::relocate(reg.second, *clipboard, internalTarget);
+	}
+	if (journal) {
+		flushedBytes += flushReplacing();
+	} else {
+		internalTarget.toStart();
+		flushedBytes += parent->flush(internalTarget, &lineIndex);
+		if(size() < originalSize){
+			internalTarget.go(size() - internalTarget.tell());
+			internalTarget.shrink();
+		}
+		internalTarget.flush();
+	}
+	++flushes;
+	originalSize = size_;
+	edited = TextCounts { };
+	if (journal) {
+		journal->reset();
+	}
+	resident = 0;
+	if (swap) {
+		swap->clear();
+	}
+	startIndexing();
+}
+
+inline size_t MemoryTarget::flushReplacing() {
+	//Beside the file the name resolves to, so the rename stays on its file system and keeps the links to it.
+	std::unique_ptr<char, decltype(&free)> resolved(realpath(filename.c_str(), nullptr), &free);
+	std::string path = resolved ? resolved.get() : filename;
+	std::string temporary = path + ".XXXXXX";
+	int fd = mkstemp(&temporary[0]);
+	if (fd < 0) {
+		throw std::runtime_error("Error creating '" + temporary + "': " + std::strerror(errno));
+	}
+	size_t written;
+	try {
+		struct stat status;
+		if (fstat(internalTarget.descriptor(), &status) < 0 || fchmod(fd, status.st_mode & 07777) < 0) {
+			throw std::runtime_error("Error copying the mode of '" + path + "': " + std::strerror(errno));
+		}
+		written = parent->flushTo(fd, internalTarget, &lineIndex);
+		if (fsync(fd) < 0 || rename(temporary.c_str(), path.c_str()) < 0) {
+			throw std::runtime_error("Error replacing '" + path + "': " + std::strerror(errno));
+		}
+	} catch (...) {
+		close(fd);
+		unlink(temporary.c_str());
+		throw;
+	}
+	close(fd);
+	//The rename itself is only durable once the directory is synced.
+	auto slash = path.rfind('/');
+	std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+	int directoryFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+	if (directoryFd >= 0) {
+		fsync(directoryFd);
+		close(directoryFd);
 	}
-	internalTarget.flush();
+	internalTarget.reopen(path);
+	return written;
 }
 
 inline size_t MemoryTarget::tell() const {
@@ -221,6 +1019,166 @@ inline void MemoryTarget::go(ptrdiff_t offset) {
 	position += offset;
 }
 
+inline size_t MemoryTarget::lines() const {
+	return counts().newlines + 1;
+}
+
+inline size_t MemoryTarget::line() const {
+	return parent->countsBefore(position).newlines;
+}
+
+inline size_t MemoryTarget::lineStart(size_t line) const {
+	if (line == 0) {
+		return 0;
+	}
+	size_t pos = parent->findNewline(line - 1);
+	return pos == MemoryNode::npos ? size_ : pos + 1;
+}
+
+inline void MemoryTarget::goLine(size_t line) {
+	position = lineStart(line);
+	if (position == size_ && line > 0) {
+		//Only a line past the end needs the whole index.
+		position = lineStart(std::min(line, size_t(counts().newlines)));
+	}
+}
+
+inline bool MemoryTarget::hasLine(size_t line) const {
+	return line == 0 || parent->findNewline(line - 1) != MemoryNode::npos;
+}
+
+inline size_t MemoryTarget::codepoints() const {
+	return counts().codepoints;
+}
+
+inline size_t MemoryTarget::codepoint() const {
+	if (position >= size_) {
+		return counts().codepoints;
+	}
+	//The one containing the position, even if it is in the middle of it.
+	size_t before = parent->countsBefore(position + 1).codepoints;
+	return before > 0 ? before - 1 : 0;
+}
+
+inline size_t MemoryTarget::codepointStart(size_t nth) const {
+	size_t pos = parent->findCodepoint(nth);
+	return pos == MemoryNode::npos ? size_ : pos;
+}
+
+inline void MemoryTarget::goCodepoints(ptrdiff_t offset) {
+	ptrdiff_t current = codepoint();
+	if (offset < 0 && -offset > current) {
+		position = 0;
+	} else {
+		position = codepointStart(current + offset);
+	}
+}
+
+inline void MemoryTarget::eraseCodepoints(size_t count) {
+	size_t current = codepoint();
+	position = codepointStart(current);
+	erase(codepointStart(current + count) - position);
+}
+
+inline bool MemoryTarget::utf8() const {
+	return lineIndex.utf8();
+}
+
+inline Encoding MemoryTarget::encoding() const {
+	return lineIndex.encoding();
+}
+
+inline bool MemoryTarget::indexed() const {
+	return lineIndex.complete();
+}
+
+inline void MemoryTarget::setMemoryBudget(size_t bytes) {
+	memoryBudget = bytes;
+	grown(0);
+}
+
+inline size_t MemoryTarget::residentSize() const {
+	return resident;
+}
+
+inline void MemoryTarget::addCursor() {
+	cursors_.add(position);
+}
+
+inline void MemoryTarget::addCursor(size_t pos) {
+	cursors_.add(pos);
+}
+
+inline void MemoryTarget::clearCursors() {
+	cursors_.clear();
+}
+
+inline CursorSet const& MemoryTarget::cursors() const {
+	return cursors_;
+}
+
+inline MemoryTarget::Stats MemoryTarget::stats() const {
+	Stats stats;
+	stats.tree = parent->stats();
+	stats.originalReads = internalTarget.reads();
+	stats.originalBytesRead = internalTarget.bytesRead();
+	stats.flushes = flushes;
+	stats.flushedBytes = flushedBytes;
+	stats.nodeAllocations = MemoryNode::allocations();
+	stats.chunkAllocations = TextChunk::allocations();
+	return stats;
+}
+
+inline void MemoryTarget::startIndexing() {
+	indexer = lineIndex.buildAsync(internalTarget, originalSize, &stop);
+}
+
+inline void MemoryTarget::finishIndexing() {
+	if (indexer.joinable()) {
+		indexer.join();
+	}
+}
+
+inline void MemoryTarget::grown(size_t count) {
+	resident += count;
+	if (memoryBudget == 0 || resident <= memoryBudget) {
+		return;
+	}
+	if (!swap) {
+		swap = std::make_unique<SwapFile>();
+	}
+	//Down to half, so it does not spill again on the next edit.
+	resident = parent->spill(*swap, position, memoryBudget / 2);
+}
+
+inline TextCounts MemoryTarget::counts() const {
+	auto counts = lineIndex.counts(0, originalSize);
+	TextCounts original { ptrdiff_t(counts.first), ptrdiff_t(counts.second) };
+	return original + edited;
+}
+
+/**
+ * @brief Writes the stats as "name: value" lines.
+ */
+inline std::ostream &operator<<(std::ostream &out, MemoryTarget::Stats const& stats) {
+	auto &tree = stats.tree;
+	return out << "branches: " << tree.branches << '\n'
+			<< "original leaves: " << tree.originalLeaves << '\n'
+			<< "modified leaves: " << tree.modifiedLeaves << '\n'
+			<< "spilled leaves: " << tree.spilledLeaves << '\n'
+			<< "shared leaves: " << tree.sharedLeaves << '\n'
+			<< "depth: " << tree.depth << '\n'
+			<< "modified bytes: " << tree.modifiedBytes << '\n'
+			<< "spilled bytes: " << tree.spilledBytes << '\n'
+			<< "shared bytes: " << tree.sharedBytes << '\n'
+			<< "original reads: " << stats.originalReads << '\n'
+			<< "original bytes read: " << stats.originalBytesRead << '\n'
+			<< "flushes: " << stats.flushes << '\n'
+			<< "flushed bytes: " << stats.flushedBytes << '\n'
+			<< "node allocations: " << stats.nodeAllocations << '\n'
+			<< "chunk allocations: " << stats.chunkAllocations;
+}
+
 }
 
 #endif /* SWEET_MEMORYTARGET_HPP_ */
@@ -0,0 +1,180 @@
+/**
+ * @file MmapTarget.hpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#ifndef SRC_MMAPTARGET_HPP_
+#define SRC_MMAPTARGET_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <string>
+#include <type_traits>
+
+#include "MappedFile.hpp"
+#include "TargetTraits.hpp"
+
+namespace sweet {
+
+/**
+ * A target mapped into memory.
+ *
+ * It writes in place, like the FileTarget, but the whole content is
+ * reachable as a contiguous buffer, so viewing it costs no copies or
+ * system calls.
+ */
+class MmapTarget {
+public:
+	using category = random_access_target_tag;
+public:
+	/**
+	 * @brief Maps the target from a file.
+	 * @param filename
+	 */
+	MmapTarget(std::string const& filename);
+
+	/**
+	 * @brief Copies `count` characters to an output iterator.
+	 *
+	 * The position is advanced past them.
+	 * @param count
+	 * @param out
+	 */
+	template<typename OUTPUT_ITERATOR>
+	void view(long count, OUTPUT_ITERATOR &&out);
+
+	/**
+	 * @brief Copies a range to an output iterator.
+	 * @param pos
+	 * @param count
+	 * @param out
+	 */
+	template<typename OUTPUT_ITERATOR>
+	void viewRange(long pos, long count, OUTPUT_ITERATOR &&out) const;
+
+	/**
+	 * @brief The content. Invalidated when the target grows or shrinks.
+	 */
+	const char *data() const;
+
+	/**
+	 * @brief Tells the number of characters.
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief  Return our current position
+	 */
+	long tell() const;
+
+	/**
+	 * @brief Goes to first position
+	 */
+	void toStart();
+
+	/**
+	 * @brief Goes to last position
+	 */
+	void toEnd();
+
+	/**
+	 * @brief Offsets position, staying within the content.
+	 * @param value
+	 */
+	void go(long value);
+
+	/**
+	 * @brief Writes the given content.
+	 *
+	 * It overwrites the current content and appends to end if necessary.
+	 * @param first
+	 * @param last
+	 */
+	template<typename FORWARD_ITERATOR>
+	void replace(FORWARD_ITERATOR first, FORWARD_ITERATOR last);
+
+	void flush();
+
+	/**
+	 * @brief Drops everything after the current position.
+	 */
+	void shrink();
+
+private:
+	MappedFile file;
+	size_t position = 0;
+};
+
+inline MmapTarget::MmapTarget(std::string const& filename) :
+		file(filename) {
+}
+
+template<typename OUTPUT_ITERATOR>
+inline void MmapTarget::view(long count, OUTPUT_ITERATOR &&out) {
+	viewRange(position, count, out);
+	position = std::min(position + count, file.size());
+}
+
+template<typename OUTPUT_ITERATOR>
+inline void MmapTarget::viewRange(long pos, long count, OUTPUT_ITERATOR &&out) const {
+	size_t first = std::min(size_t(pos), file.size());
+	size_t last = std::min(first + count, file.size());
+	std::copy(file.data() + first, file.data() + last, out);
+}
+
+inline const char *MmapTarget::data() const {
+	return file.data();
+}
+
+inline size_t MmapTarget::size() const {
+	return file.size();
+}
+
+inline long MmapTarget::tell() const {
+	return position;
+}
+
+inline void MmapTarget::toStart() {
+	position = 0;
+}
+
+inline void MmapTarget::toEnd() {
+	position = file.size();
+}
+
+inline void MmapTarget::go(long value) {
+	if (value < 0 && size_t(-value) > position) {
+		position = 0;
+	} else {
+		position = std::min(position + value, file.size());
+	}
+}
+
+template<typename FORWARD_ITERATOR>
+inline void MmapTarget::replace(FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
+	static_assert(
+			std::is_base_of<std::forward_iterator_tag, typename std::iterator_traits<FORWARD_ITERATOR>::iterator_category>::value,
+			"first and last parameters must be forward iterators"
+	);
+	size_t count = std::distance(first, last);
+	if (position + count > file.size()) {
+		file.resize(position + count);
+	}
+	std::copy(first, last, file.data() + position);
+	position += count;
+}
+
+inline void MmapTarget::flush() {
+	file.sync();
+}
+
+inline void MmapTarget::shrink() {
+	file.resize(std::min(position, file.size()));
+}
+
+}  // namespace sweet
+
+#endif /* SRC_MMAPTARGET_HPP_ */
@@ -0,0 +1,213 @@
+/**
+ * @file ReadOnlyTarget.hpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#ifndef SRC_READONLYTARGET_HPP_
+#define SRC_READONLYTARGET_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+#include "LineIndex.hpp"
+#include "MappedFile.hpp"
+#include "TargetTraits.hpp"
+
+namespace sweet {
+
+/**
+ * A target that can only be viewed.
+ *
+ * The file is opened read only and mapped, so opening is O(1) whatever its
+ * size, and the file is never created or touched. The line index is built
+ * on the background; the line queries wait only for the part they need.
+ */
+class ReadOnlyTarget {
+public:
+	using category = readonly_target_tag;
+public:
+	/**
+	 * @brief Maps the target from a file, that must exist.
+	 * @param filename
+	 */
+	ReadOnlyTarget(std::string const& filename);
+
+	/**
+	 * Dtor. Stops the indexing.
+	 */
+	~ReadOnlyTarget();
+
+	/**
+	 * @brief Copies `count` characters to an output iterator.
+	 *
+	 * The position is advanced past them.
+	 * @param count
+	 * @param out
+	 */
+	template<typename OUTPUT_ITERATOR>
+	void view(long count, OUTPUT_ITERATOR &&out);
+
+	/**
+	 * @brief Copies a range to an output iterator.
+	 * @param pos
+	 * @param count
+	 * @param out
+	 */
+	template<typename OUTPUT_ITERATOR>
+	void viewRange(long pos, long count, OUTPUT_ITERATOR &&out) const;
+
+	/**
+	 * @brief The content.
+	 */
+	const char *data() const;
+
+	/**
+	 * @brief Tells the number of characters.
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief  Return our current position
+	 */
+	long tell() const;
+
+	/**
+	 * @brief Goes to first position
+	 */
+	void toStart();
+
+	/**
+	 * @brief Goes to last position
+	 */
+	void toEnd();
+
+	/**
+	 * @brief Offsets position, staying within the content.
+	 * @param value
+	 */
+	void go(long value);
+
+	/**
+	 * @brief Tells if the line index is complete, so the line queries do not block.
+	 */
+	bool indexed() const;
+
+	/**
+	 * @brief Tells the number of lines.
+	 */
+	size_t lines() const;
+
+	/**
+	 * @brief Tells the line of the current position, zero based.
+	 */
+	size_t line() const;
+
+	/**
+	 * @brief Where a line starts.
+	 * @param line zero based.
+	 * @return the position or size() if there is no such line.
+	 */
+	size_t lineStart(size_t line) const;
+
+	/**
+	 * @brief Goes to the start of a line.
+	 * @param line zero based. If too large goes to the last line.
+	 */
+	void goLine(size_t line);
+
+private:
+	MappedFile file;
+	size_t position = 0;
+
+	LineIndex lineIndex;
+	std::atomic<bool> stop { false };
+	std::thread indexer;
+};
+
+inline ReadOnlyTarget::ReadOnlyTarget(std::string const& filename) :
+		file(filename, false) {
+	indexer = lineIndex.buildAsync(file.data(), file.size(), &stop);
+}
+
+inline ReadOnlyTarget::~ReadOnlyTarget() {
+	stop = true;
+	indexer.join();
+}
+
+template<typename OUTPUT_ITERATOR>
+inline void ReadOnlyTarget::view(long count, OUTPUT_ITERATOR &&out) {
+	viewRange(position, count, out);
+	position = std::min(position + count, file.size());
+}
+
+template<typename OUTPUT_ITERATOR>
+inline void ReadOnlyTarget::viewRange(long pos, long count, OUTPUT_ITERATOR &&out) const {
+	size_t first = std::min(size_t(pos), file.size());
+	size_t last = std::min(first + count, file.size());
+	std::copy(file.data() + first, file.data() + last, out);
+}
+
+inline const char *ReadOnlyTarget::data() const {
+	return file.data();
+}
+
+inline size_t ReadOnlyTarget::size() const {
+	return file.size();
+}
+
+inline long ReadOnlyTarget::tell() const {
+	return position;
+}
+
+inline void ReadOnlyTarget::toStart() {
+	position = 0;
+}
+
+inline void ReadOnlyTarget::toEnd() {
+	position = file.size();
+}
+
+inline void ReadOnlyTarget::go(long value) {
+	if (value < 0 && size_t(-value) > position) {
+		position = 0;
+	} else {
+		position = std::min(position + value, file.size());
+	}
+}
+
+inline bool ReadOnlyTarget::indexed() const {
+	return lineIndex.complete();
+}
+
+inline size_t ReadOnlyTarget::lines() const {
+	return lineIndex.count(0, file.size()) + 1;
+}
+
+inline size_t ReadOnlyTarget::line() const {
+	return lineIndex.count(0, std::min(position, file.size()));
+}
+
+inline size_t ReadOnlyTarget::lineStart(size_t line) const {
+	if (line == 0) {
+		return 0;
+	}
+	size_t pos = lineIndex.find(0, file.size(), line - 1);
+	return pos == LineIndex::npos ? file.size() : pos + 1;
+}
+
+inline void ReadOnlyTarget::goLine(size_t line) {
+	position = lineStart(line);
+	if (position == file.size() && line > 0) {
+		//Only a line past the end needs the whole index.
+		position = lineStart(std::min(line, lines() - 1));
+	}
+}
+
+}  // namespace sweet
+
+#endif /* SRC_READONLYTARGET_HPP_ */
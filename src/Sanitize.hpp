@@ -0,0 +1,153 @@
+/**
+ * @file Sanitize.hpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#ifndef SRC_SANITIZE_HPP_
+#define SRC_SANITIZE_HPP_
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+#include "Utf8.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace sweet {
+
+/**
+ * How the characters that can not be shown as they are get displayed.
+ */
+enum class DisplayPolicy {
+	REPLACE,	///< As a '?'.
+	CARET,		///< On caret notation, like ^A, ^? and M-^A.
+	HEX,		///< As hexadecimal escapes, like \x01.
+	UTF8,		///< Valid UTF-8 sequences pass, the rest is replaced.
+};
+
+/**
+ * @brief Gets the policy by its name (replace, caret, hex or utf8).
+ * @return false if there is no such policy.
+ */
+bool parseDisplayPolicy(std::string_view name, DisplayPolicy &policy);
+
+/**
+ * @brief Appends [first, last) to out, making it displayable.
+ *
+ * Printable ASCII is copied sixteen bytes at a time where SSE2 is
+ * available, so only the unprintable characters go through the policy.
+ * @param first
+ * @param last
+ * @param out
+ * @param policy
+ */
+void sanitize(const char *first, const char *last, std::string &out, DisplayPolicy policy = DisplayPolicy::REPLACE);
+
+/**
+ * @brief Tells if ch is printable ASCII.
+ */
+constexpr bool isPrintable(char ch) {
+	return ch >= 0x20 && ch < 0x7f;
+}
+
+/**
+ * @brief Appends the displayable form of the unprintable character at first.
+ * @return how many characters were consumed.
+ */
+inline size_t sanitizeOne(const char *first, const char *last, std::string &out, DisplayPolicy policy) {
+	static constexpr char HEX_DIGITS[] = "0123456789abcdef";
+	auto ch = static_cast<unsigned char>(*first);
+	switch (policy) {
+	case DisplayPolicy::CARET:
+		if (ch >= 0x80) {
+			out += "M-";
+			ch -= 0x80;
+			if (isPrintable(ch)) {
+				out += char(ch);
+				return 1;
+			}
+		}
+		out += '^';
+		out += ch == 0x7f ? '?' : char(ch + 0x40);
+		return 1;
+	case DisplayPolicy::HEX:
+		out += "\\x";
+		out += HEX_DIGITS[ch >> 4];
+		out += HEX_DIGITS[ch & 0xf];
+		return 1;
+	case DisplayPolicy::UTF8:
+		if (size_t length = utf8Length(first, last)) {
+			out.append(first, length);
+			return length;
+		}
+		break;
+	case DisplayPolicy::REPLACE:
+		break;
+	}
+	out += '?';
+	return 1;
+}
+
+inline bool parseDisplayPolicy(std::string_view name, DisplayPolicy &policy) {
+	if (name == "replace") {
+		policy = DisplayPolicy::REPLACE;
+	} else if (name == "caret") {
+		policy = DisplayPolicy::CARET;
+	} else if (name == "hex") {
+		policy = DisplayPolicy::HEX;
+	} else if (name == "utf8") {
+		policy = DisplayPolicy::UTF8;
+	} else {
+		return false;
+	}
+	return true;
+}
+
+inline void sanitize(const char *first, const char *last, std::string &out, DisplayPolicy policy) {
+	out.reserve(out.size() + (last - first));
+#ifdef __SSE2__
+	const __m128i low = _mm_set1_epi8(0x1f), high = _mm_set1_epi8(0x7f), question = _mm_set1_epi8('?');
+	char buffer[16];
+	while (last - first >= 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+		//Signed compares, so bytes >= 0x80 are negative and fail the first one.
+		__m128i printable = _mm_and_si128(_mm_cmpgt_epi8(chunk, low), _mm_cmplt_epi8(chunk, high));
+		unsigned mask = _mm_movemask_epi8(printable);
+		if (mask == 0xffff) {
+			out.append(first, 16);
+			first += 16;
+		} else if (policy == DisplayPolicy::REPLACE) {
+			//Blend the replacement in, no need to leave the registers.
+			chunk = _mm_or_si128(_mm_and_si128(printable, chunk), _mm_andnot_si128(printable, question));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(buffer), chunk);
+			out.append(buffer, 16);
+			first += 16;
+		} else {
+			size_t prefix = __builtin_ctz(~mask);
+			out.append(first, prefix);
+			first += prefix;
+			first += sanitizeOne(first, last, out, policy);
+		}
+	}
+#endif
+	while (first != last) {
+		const char *printable = first;
+		while (printable != last && isPrintable(*printable)) {
+			++printable;
+		}
+		out.append(first, printable);
+		first = printable;
+		if (first != last) {
+			first += sanitizeOne(first, last, out, policy);
+		}
+	}
+}
+
+}  // namespace sweet
+
+#endif /* SRC_SANITIZE_HPP_ */
@@ -0,0 +1,196 @@
+/**
+ * @file SwapFile.hpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#ifndef SRC_SWAPFILE_HPP_
+#define SRC_SWAPFILE_HPP_
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "FileCopy.hpp"
+
+namespace sweet {
+
+/**
+ * A scratch file holding content moved out of memory.
+ *
+ * It is unlinked as soon as created, so it goes away with the process.
+ * Content is only appended; the released ranges are punched out where the
+ * file system supports it, so they take no disc space.
+ */
+class SwapFile {
+public:
+	/**
+	 * @brief Creates the file on TMPDIR, or /tmp.
+	 */
+	SwapFile();
+
+	/**
+	 * Dtor. Closes the file.
+	 */
+	~SwapFile();
+
+	//We cant have these.
+	SwapFile(SwapFile const&) = delete;
+	SwapFile &operator=(SwapFile const&) = delete;
+
+	/**
+	 * @brief Appends a content.
+	 * @return the position it was written at.
+	 */
+	template<typename INPUT_ITERATOR>
+	size_t append(INPUT_ITERATOR first, INPUT_ITERATOR last);
+
+	/**
+	 * @brief Appends a range of another file, copied on the kernel if it can.
+	 * @return the position it was written at.
+	 */
+	size_t appendRange(int in, size_t pos, size_t count);
+
+	/**
+	 * @brief Reads a range. Can be called from several threads at once.
+	 * @param pos
+	 * @param count
+	 * @param buffer must have space for count characters.
+	 * @return the number of characters read.
+	 */
+	size_t readRange(size_t pos, size_t count, char *buffer) const;
+
+	/**
+	 * @brief Tells a range is not needed anymore.
+	 */
+	void release(size_t pos, size_t count);
+
+	/**
+	 * @brief Drops everything.
+	 */
+	void clear();
+
+	/**
+	 * @brief The number of characters appended since the last clear.
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief The file descriptor, for system calls.
+	 */
+	int descriptor() const;
+private:
+	void write(const char *data, size_t count);
+
+	[[noreturn]] void fail(std::string const& what) const;
+
+	static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+private:
+	std::string filename;
+	int fd;
+	size_t size_ = 0;
+};
+
+inline SwapFile::SwapFile() {
+	const char *directory = std::getenv("TMPDIR");
+	filename = std::string(directory && *directory ? directory : "/tmp") + "/sweet-swap-XXXXXX";
+	fd = mkstemp(&filename[0]);
+	if (fd < 0) {
+		fail("Error creating");
+	}
+	unlink(filename.c_str());
+}
+
+inline SwapFile::~SwapFile() {
+	close(fd);
+}
+
+template<typename INPUT_ITERATOR>
+inline size_t SwapFile::append(INPUT_ITERATOR first, INPUT_ITERATOR last) {
+	size_t pos = size_;
+	char buffer[BLOCK_SIZE];
+	while (first != last) {
+		size_t count = 0;
+		for (; first != last && count < BLOCK_SIZE; ++first) {
+			buffer[count++] = *first;
+		}
+		write(buffer, count);
+	}
+	return pos;
+}
+
+inline size_t SwapFile::appendRange(int in, size_t pos, size_t count) {
+	size_t offset = size_;
+	size_ += copyFileRange(in, pos, fd, offset, count);
+	return offset;
+}
+
+inline size_t SwapFile::readRange(size_t pos, size_t count, char* buffer) const {
+	size_t total = 0;
+	while (total < count) {
+		ssize_t read = pread(fd, buffer + total, count - total, pos + total);
+		if (read <= 0) {
+			break;
+		}
+		total += read;
+	}
+	return total;
+}
+
+inline void SwapFile::release(size_t pos, size_t count) {
+#ifdef FALLOC_FL_PUNCH_HOLE
+	//Only a hint, so failures are fine.
+	if (count > 0) {
+		fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, pos, count);
+	}
+#else
+	(void) pos;
+	(void) count;
+#endif
+}
+
+inline void SwapFile::clear() {
+	if (ftruncate(fd, 0) < 0) {
+		fail("Error truncating");
+	}
+	size_ = 0;
+}
+
+inline size_t SwapFile::size() const {
+	return size_;
+}
+
+inline int SwapFile::descriptor() const {
+	return fd;
+}
+
+inline void SwapFile::write(const char* data, size_t count) {
+	while (count > 0) {
+		ssize_t written = pwrite(fd, data, count, size_);
+		if (written < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			fail("Error writing");
+		}
+		data += written;
+		count -= written;
+		size_ += written;
+	}
+}
+
+inline void SwapFile::fail(std::string const& what) const {
+	throw std::runtime_error(what + " '" + filename + "': " + std::strerror(errno));
+}
+
+}  // namespace sweet
+
+#endif /* SRC_SWAPFILE_HPP_ */
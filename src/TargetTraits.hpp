@@ -8,18 +8,39 @@
 #ifndef SRC_TARGETTRAITS_HPP_
 #define SRC_TARGETTRAITS_HPP_
 
+#include <type_traits>
+
 namespace sweet {
 
 struct appendable_target_tag {
 };
 struct insertable_target_tag: public appendable_target_tag {
 };
+/**
+ * The content is a contiguous buffer, reachable through data() and size().
+ */
+struct random_access_target_tag: public appendable_target_tag {
+};
+/**
+ * The content can only be viewed, through data() and size().
+ *
+ * It is not an appendable_target_tag on purpose, so nothing that writes
+ * accepts it.
+ */
+struct readonly_target_tag {
+};
 
 template<typename TARGET>
 struct TargetTrait{
 	using category = typename TARGET::category;
 };
 
+/**
+ * @brief Tells if the target content can be changed.
+ */
+template<typename TARGET>
+constexpr bool isWritableTarget = std::is_base_of<appendable_target_tag, typename TargetTrait<TARGET>::category>::value;
+
 }
 
 #endif /* SRC_TARGETTRAITS_HPP_ */
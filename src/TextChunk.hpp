@@ -0,0 +1,276 @@
+/**
+ * @file TextChunk.hpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#ifndef SRC_TEXTCHUNK_HPP_
+#define SRC_TEXTCHUNK_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+
+namespace sweet {
+
+/**
+ * A buffer of bounded capacity, holding the text of a leaf.
+ *
+ * The buffer grows with the content, doubling up to CAPACITY, so the many
+ * small leaves of scattered edits take little memory.
+ *
+ * The free space is kept as a gap where the last edit happened, so a burst
+ * of typing or deleting at the same place only moves the gap ends. Moving
+ * the edit elsewhere moves the text between the old and new places.
+ *
+ * The content can be visited as at most two spans, around the gap, or as a
+ * single contiguous array, by data(), which first moves the gap to the end.
+ * Edits that do not fit must be split among several chunks by the caller.
+ */
+class TextChunk {
+public:
+	/// The maximum number of characters on a chunk.
+	static constexpr size_t CAPACITY = 4096;
+	/// The smallest buffer allocated.
+	static constexpr size_t MIN_CAPACITY = 64;
+
+	/**
+	 * @brief An empty chunk.
+	 */
+	TextChunk();
+
+	/**
+	 * @brief A chunk with the given content, that must fit.
+	 */
+	template<typename FORWARD_ITERATOR>
+	TextChunk(FORWARD_ITERATOR first, FORWARD_ITERATOR last);
+
+	/**
+	 * @brief A copy of other, with a buffer fit to its content.
+	 */
+	TextChunk(TextChunk const& other);
+
+	/**
+	 * @brief Takes the buffer of other, that is left empty.
+	 */
+	TextChunk(TextChunk&& other);
+
+	/**
+	 * @brief The number of characters.
+	 */
+	size_t size() const;
+
+	/**
+	 * @brief How many characters still fit.
+	 */
+	size_t room() const;
+
+	/**
+	 * @brief The content as an array, valid until the next change.
+	 *
+	 * Closes the gap at the end, so it is only a move after edits.
+	 */
+	const char *data();
+
+	const char *begin();
+	const char *end();
+	char operator[](size_t pos) const;
+
+	/**
+	 * @brief Calls fn(first, last) for the spans of [pos, pos + count), while it returns true.
+	 * @return false if fn did.
+	 */
+	template<typename FUNCTION>
+	bool forEachSpan(size_t pos, size_t count, FUNCTION &&fn) const;
+
+	/**
+	 * @brief Inserts at pos, shifting what is after. It must fit.
+	 */
+	template<typename FORWARD_ITERATOR>
+	void insert(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last);
+
+	/**
+	 * @brief Overwrites from pos, growing if needed. It must fit.
+	 */
+	template<typename FORWARD_ITERATOR>
+	void replace(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last);
+
+	/**
+	 * @brief Erases count characters at pos, clamped to the content.
+	 */
+	void erase(size_t pos, size_t count);
+
+	/**
+	 * @brief How many chunk buffers were allocated by the process, the regrown ones included.
+	 */
+	static size_t allocations();
+
+private:
+	void requireRoom(size_t count) const;
+
+	/**
+	 * Grows the buffer, if needed, so count characters fit.
+	 */
+	void reserve(size_t count);
+
+	/**
+	 * The size of the gap, the free space on the buffer.
+	 */
+	size_t gapSize() const;
+
+	/**
+	 * Moves the gap to start at pos.
+	 */
+	void moveGap(size_t pos);
+
+private:
+	std::unique_ptr<char[]> data_;
+	size_t capacity_ = 0;
+	size_t size_ = 0;
+	/// Where the gap starts. The content after it is at the end of the buffer.
+	size_t gap = 0;
+
+	static inline std::atomic<size_t> allocated { 0 };
+};
+
+inline TextChunk::TextChunk() {
+}
+
+template<typename FORWARD_ITERATOR>
+inline TextChunk::TextChunk(FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
+	insert(0, first, last);
+}
+
+inline TextChunk::TextChunk(TextChunk const& other) {
+	reserve(other.size_);
+	other.forEachSpan(0, other.size_, [this](const char *first, const char *last) {
+		std::copy(first, last, data_.get() + gap);
+		gap += last - first;
+		return true;
+	});
+	size_ = other.size_;
+}
+
+inline TextChunk::TextChunk(TextChunk&& other) :
+		data_(std::move(other.data_)), capacity_(other.capacity_), size_(other.size_), gap(other.gap) {
+	other.capacity_ = other.size_ = other.gap = 0;
+}
+
+inline size_t TextChunk::size() const {
+	return size_;
+}
+
+inline size_t TextChunk::room() const {
+	return CAPACITY - size_;
+}
+
+inline const char* TextChunk::data() {
+	moveGap(size_);
+	return data_.get();
+}
+
+inline const char* TextChunk::begin() {
+	return data();
+}
+
+inline const char* TextChunk::end() {
+	return data() + size_;
+}
+
+inline char TextChunk::operator[](size_t pos) const {
+	return data_[pos < gap ? pos : pos + gapSize()];
+}
+
+template<typename FUNCTION>
+inline bool TextChunk::forEachSpan(size_t pos, size_t count, FUNCTION &&fn) const {
+	size_t first = std::min(pos, size_);
+	size_t last = first + std::min(count, size_ - first);
+	if (first < gap && !fn((const char*) data_.get() + first, (const char*) data_.get() + std::min(last, gap))) {
+		return false;
+	}
+	first = std::max(first, gap);
+	if (first < last && !fn((const char*) data_.get() + first + gapSize(), (const char*) data_.get() + last + gapSize())) {
+		return false;
+	}
+	return true;
+}
+
+template<typename FORWARD_ITERATOR>
+inline void TextChunk::insert(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
+	size_t count = std::distance(first, last);
+	requireRoom(size_ + count);
+	reserve(size_ + count);
+	moveGap(pos);
+	std::copy(first, last, data_.get() + gap);
+	gap += count;
+	size_ += count;
+}
+
+template<typename FORWARD_ITERATOR>
+inline void TextChunk::replace(size_t pos, FORWARD_ITERATOR first, FORWARD_ITERATOR last) {
+	size_t count = std::distance(first, last);
+	requireRoom(pos + count);
+	erase(pos, count);
+	insert(pos, first, last);
+}
+
+inline void TextChunk::erase(size_t pos, size_t count) {
+	pos = std::min(pos, size_);
+	count = std::min(count, size_ - pos);
+	if (pos + count == gap) {
+		//Backspacing just widens the gap.
+		gap = pos;
+	} else {
+		moveGap(pos);
+	}
+	size_ -= count;
+}
+
+inline size_t TextChunk::allocations() {
+	return allocated.load(std::memory_order_relaxed);
+}
+
+inline void TextChunk::requireRoom(size_t count) const {
+	if (count > CAPACITY) {
+		throw std::length_error("Text chunk overflow");
+	}
+}
+
+inline void TextChunk::reserve(size_t count) {
+	if (count <= capacity_) {
+		return;
+	}
+	size_t capacity = std::min(CAPACITY, std::max({ count, 2 * capacity_, MIN_CAPACITY }));
+	std::unique_ptr<char[]> buffer(new char[capacity]);
+	allocated.fetch_add(1, std::memory_order_relaxed);
+	size_t after = size_ - gap;
+	if (data_) {
+		std::copy(data_.get(), data_.get() + gap, buffer.get());
+		std::copy(data_.get() + capacity_ - after, data_.get() + capacity_, buffer.get() + capacity - after);
+	}
+	data_ = std::move(buffer);
+	capacity_ = capacity;
+}
+
+inline size_t TextChunk::gapSize() const {
+	return capacity_ - size_;
+}
+
+inline void TextChunk::moveGap(size_t pos) {
+	char *buffer = data_.get();
+	if (pos < gap) {
+		memmove(buffer + pos + gapSize(), buffer + pos, gap - pos);
+	} else if (pos > gap) {
+		memmove(buffer + gap, buffer + gap + gapSize(), pos - gap);
+	}
+	gap = pos;
+}
+
+}  // namespace sweet
+
+#endif /* SRC_TEXTCHUNK_HPP_ */
@@ -0,0 +1,183 @@
+/**
+ * @file Utf8.hpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#ifndef SRC_UTF8_HPP_
+#define SRC_UTF8_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace sweet {
+
+/**
+ * The encodings a content can be detected as.
+ */
+enum class Encoding {
+	ASCII,  ///< Only 7 bit characters
+	UTF8,   ///< Valid UTF-8 with some multibyte sequence
+	UNKNOWN ///< Anything else, possibly binary
+};
+
+/**
+ * @brief Tells if ch continues a multibyte sequence, so no codepoint starts on it.
+ */
+constexpr bool isContinuation(char ch) {
+	return (static_cast<unsigned char>(ch) & 0xc0) == 0x80;
+}
+
+/**
+ * @brief The length of the sequence ch starts, or 1 if it is not a valid lead byte.
+ */
+constexpr size_t leadLength(char ch) {
+	auto lead = static_cast<unsigned char>(ch);
+	return lead >= 0xf0 && lead < 0xf5 ? 4 : lead >= 0xe0 && lead < 0xf0 ? 3 : lead >= 0xc2 && lead < 0xe0 ? 2 : 1;
+}
+
+/**
+ * @brief Length of the valid UTF-8 sequence at first, or 0 if invalid.
+ */
+inline size_t utf8Length(const char *first, const char *last) {
+	auto lead = static_cast<unsigned char>(*first);
+	size_t length;
+	unsigned min;
+	if (lead >= 0xc2 && lead < 0xe0) {
+		length = 2;
+		min = 0x80;
+	} else if (lead >= 0xe0 && lead < 0xf0) {
+		length = 3;
+		min = 0x800;
+	} else if (lead >= 0xf0 && lead < 0xf5) {
+		length = 4;
+		min = 0x10000;
+	} else {
+		return 0;
+	}
+	if (size_t(last - first) < length) {
+		return 0;
+	}
+	unsigned codepoint = lead & (0x3f >> (length - 1));
+	for (size_t i = 1; i < length; ++i) {
+		if (!isContinuation(first[i])) {
+			return 0;
+		}
+		codepoint = codepoint << 6 | (first[i] & 0x3f);
+	}
+	if (codepoint < min || codepoint > 0x10ffff || (codepoint >= 0xd800 && codepoint < 0xe000)) {
+		return 0;
+	}
+	return length;
+}
+
+/**
+ * @brief Mask of the continuation bytes on [first, first + count).
+ *
+ * Bit i is set if first[i] is a continuation byte.
+ * @param first
+ * @param count at most 64.
+ */
+inline uint64_t continuationMask(const char *first, size_t count) {
+	uint64_t mask = 0;
+	size_t i = 0;
+#ifdef __SSE2__
+	//Signed compare: continuation bytes, 0x80 to 0xbf, are the ones below -64.
+	const __m128i limit = _mm_set1_epi8(-64);
+	for (; i + 16 <= count; i += 16) {
+		__m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + i));
+		mask |= uint64_t(unsigned(_mm_movemask_epi8(_mm_cmplt_epi8(chunk, limit)))) << i;
+	}
+#endif
+	for (; i < count; ++i) {
+		mask |= uint64_t(isContinuation(first[i])) << i;
+	}
+	return mask;
+}
+
+/**
+ * Validates UTF-8 fed in pieces, so sequences may cross the piece borders.
+ */
+class Utf8Validator {
+public:
+	/**
+	 * @brief Validates the next piece.
+	 *
+	 * Runs of ASCII are skipped sixteen bytes at a time where SSE2 is
+	 * available.
+	 */
+	void feed(const char *first, const char *last);
+
+	/**
+	 * @brief Tells if everything fed so far is valid and complete.
+	 */
+	bool valid() const;
+
+	/**
+	 * @brief Tells if it is in the middle of a sequence, waiting for more bytes.
+	 */
+	bool inSequence() const;
+private:
+	bool invalid = false;
+	unsigned pending = 0, codepoint = 0, min = 0;
+};
+
+inline void Utf8Validator::feed(const char *first, const char *last) {
+	while (first != last && !invalid) {
+#ifdef __SSE2__
+		if (pending == 0) {
+			while (last - first >= 16 &&
+					_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(first))) == 0) {
+				first += 16;
+			}
+			if (first == last) {
+				break;
+			}
+		}
+#endif
+		auto ch = static_cast<unsigned char>(*first++);
+		if (pending > 0) {
+			if (!isContinuation(ch)) {
+				invalid = true;
+			} else {
+				codepoint = codepoint << 6 | (ch & 0x3f);
+				if (--pending == 0) {
+					invalid = codepoint < min || codepoint > 0x10ffff || (codepoint >= 0xd800 && codepoint < 0xe000);
+				}
+			}
+		} else if (ch < 0x80) {
+			continue;
+		} else if (ch >= 0xc2 && ch < 0xe0) {
+			pending = 1;
+			codepoint = ch & 0x1f;
+			min = 0x80;
+		} else if (ch >= 0xe0 && ch < 0xf0) {
+			pending = 2;
+			codepoint = ch & 0x0f;
+			min = 0x800;
+		} else if (ch >= 0xf0 && ch < 0xf5) {
+			pending = 3;
+			codepoint = ch & 0x07;
+			min = 0x10000;
+		} else {
+			invalid = true;
+		}
+	}
+}
+
+inline bool Utf8Validator::valid() const {
+	return !invalid && pending == 0;
+}
+
+inline bool Utf8Validator::inSequence() const {
+	return !invalid && pending > 0;
+}
+
+}  // namespace sweet
+
+#endif /* SRC_UTF8_HPP_ */
@@ -1,16 +1,39 @@
+#include <chrono>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
 #include <string>
 #include <boost/program_options.hpp>
 
 #include "ConsoleEditor.hpp"
 #include "MemoryTarget.hpp"
+#include "MmapTarget.hpp"
+#include "ReadOnlyTarget.hpp"
 
 using namespace std;
 using namespace sweet;
 
-template<typename TARGET>
-void run(string const &fileName);
+template<typename TARGET, typename... ARGS>
+void run(string const &fileName, DisplayPolicy display, ARGS... args);
+
+template<typename TARGET, typename... ARGS>
+void runScript(string const &fileName, string const &scriptName, ARGS... args);
+
+/**
+ * Parses the journal sync policy.
+ */
+bool parseSync(string const &name, Journal::Sync &sync) {
+	if (name == "each") {
+		sync = Journal::Sync::EACH;
+	} else if (name == "periodic") {
+		sync = Journal::Sync::PERIODIC;
+	} else if (name == "never") {
+		sync = Journal::Sync::NEVER;
+	} else {
+		return false;
+	}
+	return true;
+}
 
 int main(int argc, char **argv) {
 	namespace po = boost::program_options;
@@ -24,6 +47,28 @@ int main(int argc, char **argv) {
 					" save command any time. It can be also be saved without"
 					" any requisition depending of your underline platform."
 			)
+			("mmap,m", "Map the file into memory and edit it in place. Viewing"
+					" is then fast on any file size, but there is no insertion.")
+			("readonly,r", "Only view the file, that is never opened for"
+					" writing. It opens instantly, whatever the size, and the"
+					" lines are indexed on the background.")
+			("journal,j", po::value<string>()->implicit_value("periodic"),
+					"Record the unsaved edits on a journal, the file name"
+					" plus .journal, and restore them when the file is opened"
+					" again. It is synced to the disc on each edit, periodic"
+					" (at most once a second) or never, leaving it to the"
+					" system. Not available with the other modes.")
+			("memory-budget", po::value<size_t>(), "Keep at most this many"
+					" megabytes of edited text in memory, moving the rest to a"
+					" temporary swap file. Not available with the other modes.")
+			("script", po::value<string>(), "Run the commands from the given"
+					" file, one per line, without rendering between them, and"
+					" report the elapsed time. Use - to read them from the"
+					" standard input.")
+			("display", po::value<string>()->default_value("replace"),
+					"How to show unprintable characters: replace (as ?),"
+					" caret (as ^A), hex (as \\x01) or utf8 (valid UTF-8"
+					" is shown, the rest replaced).")
 			("file", po::value<string>(), "The file to edit. You can omit the"
 					" --file")
 			;
@@ -46,10 +91,40 @@ int main(int argc, char **argv) {
 		cout << "Version 0.2" << endl;
 	} else if(programOptions.count("file")) {
 		auto fileName = programOptions["file"].as<string>();
-		if(programOptions.count("direct-mode")){
-			run<FileTarget>(fileName);
+		DisplayPolicy display;
+		if(!parseDisplayPolicy(programOptions["display"].as<string>(), display)){
+			cerr << "Unknown display '" << programOptions["display"].as<string>() << "'" << endl;
+			return 1;
+		}
+		MemoryTarget::Options memoryOptions;
+		memoryOptions.journal = programOptions.count("journal");
+		memoryOptions.log = &cerr;
+		if(memoryOptions.journal && !parseSync(programOptions["journal"].as<string>(), memoryOptions.sync)){
+			cerr << "Unknown journal sync '" << programOptions["journal"].as<string>() << "'" << endl;
+			return 1;
+		}
+		if(programOptions.count("memory-budget")){
+			memoryOptions.memoryBudget = programOptions["memory-budget"].as<size_t>() * 1024 * 1024;
+		}
+		if(programOptions.count("script")){
+			auto scriptName = programOptions["script"].as<string>();
+			if(programOptions.count("readonly")){
+				runScript<ReadOnlyTarget>(fileName, scriptName);
+			} else if(programOptions.count("direct-mode")){
+				runScript<FileTarget>(fileName, scriptName);
+			} else if(programOptions.count("mmap")){
+				runScript<MmapTarget>(fileName, scriptName);
+			} else {
+				runScript<MemoryTarget>(fileName, scriptName, memoryOptions);
+			}
+		} else if(programOptions.count("readonly")){
+			run<ReadOnlyTarget>(fileName, display);
+		} else if(programOptions.count("direct-mode")){
+			run<FileTarget>(fileName, display);
+		} else if(programOptions.count("mmap")){
+			run<MmapTarget>(fileName, display);
 		} else {
-			run<MemoryTarget>(fileName);
+			run<MemoryTarget>(fileName, display, memoryOptions);
 		}
 	} else {
 		cerr << "Expected file name" << endl;
@@ -57,10 +132,11 @@ int main(int argc, char **argv) {
 	return 0;
 }
 
-template<typename TARGET>
-void run(string const &fileName) {
-	ConsoleEditor<TARGET> editor { fileName };
-	editor.registerCustomCommand('q', [](const std::string&) {
+template<typename TARGET, typename... ARGS>
+void run(string const &fileName, DisplayPolicy display, ARGS... args) {
+	ConsoleEditor<TARGET> editor { fileName, args... };
+	editor.setDisplay(display);
+	editor.registerCustomCommand('q', [](std::string_view) -> typename ConsoleEditor<TARGET>::Change {
 		cout << "Exited Successfully" << endl;
 		exit(0);
 	});
@@ -73,3 +149,36 @@ void run(string const &fileName) {
 		} while (line.size() == 0);
 	} while (editor.update(line));
 }
+
+template<typename TARGET, typename... ARGS>
+void runScript(string const &fileName, string const &scriptName, ARGS... args) {
+	ifstream scriptFile;
+	if(scriptName != "-"){
+		scriptFile.open(scriptName);
+		if(!scriptFile){
+			cerr << "Can not open script '" << scriptName << "'" << endl;
+			return;
+		}
+	}
+	istream &script = scriptName == "-" ? cin : scriptFile;
+	cin.tie(nullptr);
+
+	ConsoleEditor<TARGET> editor { fileName, args... };
+	bool running = true;
+	editor.registerCustomCommand('q', [&running](std::string_view) {
+		running = false;
+		return ConsoleEditor<TARGET>::Change::NONE;
+	});
+	auto start = chrono::steady_clock::now();
+	size_t count = 0;
+	string line;
+	while(running && getline(script, line)) {
+		if(line.size() > 0){
+			editor.update(line);
+			++count;
+		}
+	}
+	chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+	cout.flush();
+	cerr << count << " commands in " << elapsed.count() << "s" << endl;
+}
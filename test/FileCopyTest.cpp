@@ -0,0 +1,78 @@
+/**
+ * @file FileCopyTest.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "../src/FileCopy.hpp"
+
+#include "catch.hpp"
+#include "fileUtils.hpp"
+
+inline std::string numbered(size_t size){
+	std::string content;
+	for (size_t i = 0; content.size() < size; ++i) {
+		content += std::to_string(i) + ",";
+	}
+	content.resize(size);
+	return content;
+}
+
+inline std::string readFile(const char *path){
+	std::ifstream f { path, ios_base::binary };
+	return std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>());
+}
+
+TEST_CASE("File Copy", "[copy]"){
+	auto path = TEST_FILE("copied.txt");
+	std::string content = numbered(1024 * 1024);
+	{
+		std::ofstream f { path, ios_base::binary };
+		f << content;
+	}
+	int fd = open(path, O_RDWR);
+	REQUIRE(fd >= 0);
+	auto moved = [&](size_t from, size_t to, size_t count) {
+		std::string expected = content;
+		expected.resize(std::max(expected.size(), to + count));
+		std::copy(content.begin() + from, content.begin() + from + count, expected.begin() + to);
+		return expected;
+	};
+
+	SECTION("close ranges, to the right"){
+		REQUIRE(copyFileRange(fd, 10, fd, 17, 500000) == 500000);
+		REQUIRE(readFile(path) == moved(10, 17, 500000));
+	}
+	SECTION("close ranges, to the left"){
+		REQUIRE(copyFileRange(fd, 17, fd, 10, 500000) == 500000);
+		REQUIRE(readFile(path) == moved(17, 10, 500000));
+	}
+	SECTION("far ranges, to the right"){
+		REQUIRE(copyFileRange(fd, 100, fd, 100 + 70000, 900000) == 900000);
+		REQUIRE(readFile(path) == moved(100, 100 + 70000, 900000));
+	}
+	SECTION("far ranges, to the left"){
+		REQUIRE(copyFileRange(fd, 100 + 70000, fd, 100, 900000) == 900000);
+		REQUIRE(readFile(path) == moved(100 + 70000, 100, 900000));
+	}
+	SECTION("past the end of the input"){
+		REQUIRE(copyFileRange(fd, content.size() - 10, fd, 0, 100) == 10);
+		REQUIRE(bufferedCopyFileRange(fd, content.size() - 10, fd, 0, 100) == 10);
+	}
+	SECTION("between files"){
+		auto otherPath = TEST_FILE("copied_other.txt");
+		populateFile(otherPath, "");
+		int other = open(otherPath, O_RDWR);
+		REQUIRE(copyFileRange(fd, 5, other, 0, 300000) == 300000);
+		writeFileRange(other, 300000, "end", 3);
+		close(other);
+		REQUIRE(readFile(otherPath) == content.substr(5, 300000) + "end");
+	}
+	close(fd);
+}
@@ -0,0 +1,233 @@
+/**
+ * @file JournalTest.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../src/Journal.hpp"
+#include "../src/MemoryTarget.hpp"
+
+#include "catch.hpp"
+#include "fileUtils.hpp"
+
+inline std::string readAll(MemoryTarget &target){
+	std::string buffer;
+	target.viewAll(back_inserter(buffer));
+	return buffer;
+}
+
+inline std::string replayAll(Journal &journal){
+	std::string records;
+	journal.replay([&](Journal::Operation operation, size_t pos, size_t count, const char *content) {
+		records += std::to_string(int(operation)) + "@" + std::to_string(pos) + ":";
+		records += operation == Journal::Operation::ERASE ? std::to_string(count) : std::string(content, count);
+		records += ";";
+	});
+	return records;
+}
+
+TEST_CASE("Journal records", "[journal]"){
+	auto path = TEST_FILE("journaled.txt");
+	std::string journalPath = std::string(path) + ".journal";
+	populateFile(path, "Hello World");
+	std::remove(journalPath.c_str());
+	std::string text = "abc";
+	{
+		Journal journal(journalPath, path, Journal::Sync::EACH);
+		REQUIRE(replayAll(journal) == "");
+		journal.insert(1, text.begin(), text.end());
+		journal.erase(2, 5);
+		journal.commit();
+		journal.replace(0, text.begin(), text.begin() + 1);
+	}
+
+	SECTION("replayed on reopen"){
+		Journal journal(journalPath, path, Journal::Sync::NEVER);
+		REQUIRE(replayAll(journal) == "1@1:abc;2@2:5;3@0:a;");
+		journal.erase(7, 1);
+		journal.commit();
+		REQUIRE(replayAll(journal) == "1@1:abc;2@2:5;3@0:a;2@7:1;");
+	}
+	SECTION("torn tail is cut"){
+		{
+			std::ofstream f { journalPath, ios_base::binary | ios_base::app };
+			f << "\x01garbage";
+		}
+		Journal journal(journalPath, path);
+		REQUIRE(replayAll(journal) == "1@1:abc;2@2:5;3@0:a;");
+		journal.erase(7, 1);
+		journal.commit();
+		REQUIRE(replayAll(journal) == "1@1:abc;2@2:5;3@0:a;2@7:1;");
+	}
+	SECTION("discarded when the target changes"){
+		populateFile(path, "Hello World!");
+		Journal journal(journalPath, path);
+		REQUIRE(replayAll(journal) == "");
+	}
+	SECTION("reset"){
+		Journal journal(journalPath, path);
+		journal.reset();
+		REQUIRE(replayAll(journal) == "");
+	}
+}
+
+TEST_CASE("Memory Target Journal", "[journal]"){
+	auto path = TEST_FILE("journaled.txt");
+	std::string journalPath = std::string(path) + ".journal";
+	populateFile(path, "Hello World");
+	std::remove(journalPath.c_str());
+	std::string text = "Big ";
+
+	SECTION("edits are replayed"){
+		{
+			MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::NEVER });
+			target.go(6);
+			target.insert(text.begin(), text.end());
+			target.toStart();
+			target.erase(1);
+			target.replace(text.begin(), text.begin() + 1);
+			target.addCursor(4);
+			target.addCursor(8);
+			text = "_";
+			target.insertAtCursors(text.begin(), text.end());
+			target.eraseAtCursors(1);
+			REQUIRE(readAll(target) == "Bllo_Big_World");
+		}
+		REQUIRE(getFileContent(path) == "Hello World");
+		MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::PERIODIC });
+		REQUIRE(readAll(target) == "Bllo_Big_World");
+		REQUIRE(target.tell() == 0);
+	}
+	SECTION("inserted files are replayed by reference"){
+		auto sourcePath = TEST_FILE("journaled_source.txt");
+		std::string source(3 * TextChunk::CAPACITY, 's');
+		populateFile(sourcePath, source.c_str());
+		{
+			MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::NEVER });
+			target.go(6);
+			target.insertFile(sourcePath, 10, 2 * TextChunk::CAPACITY);
+		}
+		auto journaled = getFileContent(journalPath.c_str());
+		REQUIRE(journaled.size() < TextChunk::CAPACITY);
+		std::string expected = "Hello " + source.substr(10, 2 * TextChunk::CAPACITY) + "World";
+		std::ostringstream log;
+		SECTION("from the same directory"){
+			MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::NEVER, 0, &log });
+			REQUIRE(readAll(target) == expected);
+		}
+		SECTION("from another directory"){
+			std::unique_ptr<char, decltype(&free)> absolute(realpath(path, nullptr), &free);
+			std::unique_ptr<char, decltype(&free)> directory(getcwd(nullptr, 0), &free);
+			REQUIRE(chdir("/") == 0);
+			std::string content;
+			{
+				MemoryTarget target(absolute.get(), MemoryTarget::Options { true, Journal::Sync::NEVER, 0, &log });
+				content = readAll(target);
+			}
+			REQUIRE(chdir(directory.get()) == 0);
+			REQUIRE(content == expected);
+		}
+		SECTION("not if the source changed"){
+			populateFile(sourcePath, "changed");
+			MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::NEVER, 0, &log });
+			REQUIRE(readAll(target) == "Hello World");
+			REQUIRE(log.str().find("not replayed") != std::string::npos);
+		}
+		SECTION("not if the source went away"){
+			std::remove(sourcePath);
+			MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::NEVER, 0, &log });
+			REQUIRE(readAll(target) == "Hello World");
+			REQUIRE(log.str().find("not replayed") != std::string::npos);
+		}
+	}
+	SECTION("pastes are replayed"){
+		{
+			MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::NEVER });
+			target.copy(6);
+			target.toEnd();
+			target.paste();
+			REQUIRE(readAll(target) == "Hello WorldHello ");
+		}
+		MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::NEVER });
+		REQUIRE(readAll(target) == "Hello WorldHello ");
+	}
+	SECTION("moves are replayed"){
+		{
+			MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::NEVER });
+			target.move(0, 6, 11);
+			REQUIRE(readAll(target) == "WorldHello ");
+		}
+		MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::NEVER });
+		REQUIRE(readAll(target) == "WorldHello ");
+	}
+	SECTION("short moves are not"){
+		{
+			MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::NEVER });
+			target.insert(text.begin(), text.end());
+		}
+		//A move record holding 4 bytes instead of 16, with a valid checksum.
+		std::string record(1, char(Journal::Operation::MOVE));
+		uint64_t head[2] = { 0, 4 };
+		record.append(reinterpret_cast<const char*>(head), sizeof(head));
+		record += "\x05\0\0\0"s;
+		uint32_t hash = 2166136261u;
+		for (char c : record) {
+			hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+		}
+		record.append(reinterpret_cast<const char*>(&hash), sizeof(hash));
+		{
+			std::ofstream f { journalPath, ios_base::binary | ios_base::app };
+			f << record;
+		}
+		std::ostringstream log;
+		MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::NEVER, 0, &log });
+		REQUIRE(readAll(target) == "Big Hello World");
+		REQUIRE(log.str().find("not replayed") != std::string::npos);
+	}
+	SECTION("flushed edits are not"){
+		{
+			MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::EACH });
+			target.go(6);
+			target.insert(text.begin(), text.end());
+			target.flush();
+		}
+		REQUIRE(getFileContent(path) == "Hello Big World");
+		MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::EACH });
+		REQUIRE(readAll(target) == "Hello Big World");
+		REQUIRE(target.lines() == 1);
+	}
+	SECTION("the flush replaces the file"){
+		REQUIRE(chmod(path, 0640) == 0);
+		struct stat before, after;
+		REQUIRE(stat(path, &before) == 0);
+		{
+			MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::EACH });
+			target.copy(5);
+			target.go(6);
+			target.insert(text.begin(), text.end());
+			target.flush();
+			REQUIRE(stat(path, &after) == 0);
+			REQUIRE(after.st_ino != before.st_ino);
+			target.toEnd();
+			target.paste();
+			target.flush();
+			REQUIRE(readAll(target) == "Hello Big WorldHello");
+			target.insert(text.begin(), text.end());
+		}
+		REQUIRE(stat(path, &after) == 0);
+		REQUIRE((after.st_mode & 07777) == 0640);
+		REQUIRE(getFileContent(path) == "Hello Big WorldHello");
+		MemoryTarget target(path, MemoryTarget::Options { true, Journal::Sync::EACH });
+		REQUIRE(readAll(target) == "Hello Big WorldHelloBig ");
+	}
+}
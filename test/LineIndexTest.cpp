@@ -0,0 +1,121 @@
+/**
+ * @file LineIndexTest.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include "../src/LineIndex.hpp"
+
+#include "catch.hpp"
+#include "fileUtils.hpp"
+
+/**
+ * Several blocks of text, with multibyte characters crossing the block borders.
+ */
+inline std::string blocksContent(){
+	std::string content;
+	const char *pieces[] = { "line\n", "\xc3\xa9", "\xe6\x97\xa5", "x", "\xf0\x9f\x98\x80" };
+	for (size_t i = 0; content.size() < 3 * 1024 * 1024 + 100; ++i) {
+		content += pieces[i % 5];
+	}
+	return content;
+}
+
+inline size_t naiveCodepoints(std::string const& content, size_t first, size_t last){
+	size_t count = 0;
+	for (size_t i = first; i < last; ++i) {
+		count += !isContinuation(content[i]);
+	}
+	return count;
+}
+
+TEST_CASE("Line Index Test", "[index]"){
+	auto content = blocksContent();
+	auto path = TEST_FILE("index.txt");
+	populateFile(path, content.c_str());
+	//The index reads the content again on queries.
+	FileTarget file(path);
+	LineIndex index;
+	SECTION("from memory"){
+		index.build(content.data(), content.size());
+	}
+	SECTION("from file"){
+		index.build(file, content.size());
+	}
+	SECTION("on background"){
+		std::atomic<bool> stop { false };
+		auto thread = index.buildAsync(content.data(), content.size(), &stop);
+		//Every 15 bytes there is a newline.
+		size_t pos = index.find(0, content.size(), 10);
+		thread.join();
+		REQUIRE(pos == 10 * 15 + 4);
+	}
+	REQUIRE(index.complete());
+	REQUIRE(index.utf8());
+	size_t newlines = std::count(content.begin(), content.end(), '\n');
+	REQUIRE(index.count(0, content.size()) == newlines);
+	size_t border = 1024 * 1024;
+	REQUIRE(index.count(border - 7, 2 * border + 9) == size_t(std::count(content.begin() + border - 7, content.begin() + 2 * border + 9, '\n')));
+	size_t nth = index.count(0, border);
+	REQUIRE(index.find(0, content.size(), nth) == content.find('\n', border));
+	REQUIRE(index.find(0, content.size(), newlines) == LineIndex::npos);
+	REQUIRE(index.codepoints(0, content.size()) == naiveCodepoints(content, 0, content.size()));
+	REQUIRE(index.codepoints(border - 3, border + 70) == naiveCodepoints(content, border - 3, border + 70));
+	size_t before = naiveCodepoints(content, 0, border);
+	size_t start = index.findCodepoint(0, content.size(), before);
+	REQUIRE(start >= border);
+	REQUIRE(naiveCodepoints(content, 0, start) == before);
+	REQUIRE_FALSE(isContinuation(content[start]));
+	REQUIRE(index.findCodepoint(10, 20, 100) == LineIndex::npos);
+	//Around the checkpoints, where the content is scanned.
+	for (size_t pos = 4096 - 5; pos < content.size(); pos += 4096 * 37 + 1) {
+		REQUIRE(index.count(0, pos) == size_t(std::count(content.begin(), content.begin() + pos, '\n')));
+		REQUIRE(index.count(pos, pos + 9000) == size_t(std::count(content.begin() + pos, content.begin() + std::min(pos + 9000, content.size()), '\n')));
+		REQUIRE(index.codepoints(pos, pos + 9000) == naiveCodepoints(content, pos, std::min(pos + 9000, content.size())));
+		size_t line = index.find(pos, content.size(), 300);
+		REQUIRE(line == content.find('\n', line - 1));
+		REQUIRE(size_t(std::count(content.begin() + pos, content.begin() + line, '\n')) == 300);
+		size_t start = index.findCodepoint(pos, content.size(), 5000);
+		REQUIRE(naiveCodepoints(content, pos, start) == 5000);
+		REQUIRE_FALSE(isContinuation(content[start]));
+	}
+}
+
+TEST_CASE("Line Index long lines", "[index]"){
+	std::string content(3 * 1024 * 1024, 'a');
+	for (size_t pos = 100; pos < content.size(); pos += 300000) {
+		content[pos] = '\n';
+	}
+	LineIndex index;
+	index.build(content.data(), content.size());
+	size_t newlines = std::count(content.begin(), content.end(), '\n');
+	REQUIRE(index.count(0, content.size()) == newlines);
+	for (size_t nth = 0; nth < newlines; ++nth) {
+		REQUIRE(index.find(0, content.size(), nth) == 100 + nth * 300000);
+	}
+	REQUIRE(index.find(0, content.size(), newlines) == LineIndex::npos);
+	REQUIRE(index.findCodepoint(0, content.size(), 2 * 1024 * 1024 + 5) == 2 * 1024 * 1024 + 5);
+	REQUIRE(index.encoding() == Encoding::ASCII);
+}
+
+TEST_CASE("Line Index empty content", "[index]"){
+	LineIndex index;
+	index.build("", 0);
+	REQUIRE(index.complete());
+	REQUIRE(index.count(0, 0) == 0);
+	REQUIRE(index.find(0, 0, 0) == LineIndex::npos);
+	REQUIRE(index.findCodepoint(0, 0, 0) == LineIndex::npos);
+}
+
+TEST_CASE("Line Index invalid borders", "[index]"){
+	std::string content(1024 * 1024 - 1, 'a');
+	content += "\xe6\x97\xa5";
+	content += "\x97";
+	LineIndex index;
+	index.build(content.data(), content.size());
+	REQUIRE_FALSE(index.utf8());
+	content.pop_back();
+	index.build(content.data(), content.size());
+	REQUIRE(index.utf8());
+}
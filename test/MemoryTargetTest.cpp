@@ -5,6 +5,10 @@
  * @author talesm
  */
 
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+
 #include "../src/MemoryTarget.hpp"
 
 #include "catch.hpp"
@@ -160,8 +164,719 @@ TEST_CASE("Memory Target Test", "[target]"){
 		REQUIRE(readAll(target) == "Hi Weird");
 		REQUIRE(getFileContent(path1) == "Hello World");
 		target.flush();
-//		REQUIRE(readAll(target) == "Hi Weird");
+		REQUIRE(readAll(target) == "Hi Weird");
 		REQUIRE(getFileContent(path1) == "Hi Weird");
 	}
+
+	SECTION("view ranges across nodes"){
+		insert(target, "Oh, ");
+		target.go(5);
+		insert(target, "...");
+		REQUIRE(readAll(target) == "Oh, Hello... World");
+		REQUIRE(readRange(target, 2, 5) == ", Hel");
+		REQUIRE(readRange(target, 7, 8) == "lo... Wo");
+		REQUIRE(readRange(target, 15, 10) == "rld");
+	}
+
+	SECTION("iterator"){
+		insert(target, "Oh, ");
+		target.go(5);
+		insert(target, "...");
+		std::string content(target.begin(), target.end());
+		REQUIRE(content == "Oh, Hello... World");
+		REQUIRE(std::string(std::make_reverse_iterator(target.end()), std::make_reverse_iterator(target.begin()))
+				== "dlroW ...olleH ,hO");
+		REQUIRE(target.end() - target.begin() == 18);
+		REQUIRE(target.begin()[13] == 'W');
+		auto it = std::find(target.begin(), target.end(), '.');
+		REQUIRE(it - target.begin() == 9);
+		REQUIRE(*--it == 'o');
+		REQUIRE(std::count(target.begin(), target.end(), 'o') == 2);
+		std::string needle = "lo.";
+		REQUIRE(std::search(target.begin(), target.end(), needle.begin(), needle.end()) - target.begin() == 7);
+		REQUIRE(std::distance(target.begin(), target.end()) == 18);
+		REQUIRE(std::prev(target.end())[0] == 'd');
+		target.toStart();
+		target.erase(target.size());
+		insert(target, "aceg");
+		insert(target, "ikmo");
+		REQUIRE(std::lower_bound(target.begin(), target.end(), 'h') - target.begin() == 4);
+		REQUIRE(std::lower_bound(target.begin(), target.end(), 'm') - target.begin() == 6);
+	}
+
+	SECTION("segments"){
+		insert(target, "Oh, ");
+		std::vector<std::string> segments;
+		target.forEachSegment(2, 6, [&](auto first, auto last) {
+			segments.emplace_back(first, last);
+			return true;
+		});
+		REQUIRE(segments == std::vector<std::string>({", ", "Hell"}));
+		size_t visited = 0;
+		REQUIRE_FALSE(forEachSegment(target.begin(), target.end(), [&](auto, auto) {
+			return ++visited < 1;
+		}));
+		REQUIRE(visited == 1);
+	}
+
+	SECTION("cursors follow edits"){
+		target.addCursor(2);
+		target.addCursor(6);
+		target.addCursor(9);
+		insert(target, ">>");
+		REQUIRE(target.cursors().positions() == std::vector<size_t>({4, 8, 11}));
+		target.go(2);
+		target.erase(5);
+		REQUIRE(readAll(target) == ">>Heorld");
+		REQUIRE(target.cursors().positions() == std::vector<size_t>({4, 4, 6}));
+		target.clearCursors();
+		REQUIRE(target.cursors().empty());
+	}
+
+	SECTION("insert at cursors"){
+		target.addCursor(0);
+		target.addCursor(5);
+		target.addCursor(11);
+		target.go(6);
+		insert(target, "big ");
+		REQUIRE(readAll(target) == "Hello big World");
+		std::string value = "*";
+		target.insertAtCursors(value.begin(), value.end());
+		REQUIRE(readAll(target) == "*Hello* big World*");
+		REQUIRE(target.cursors().positions() == std::vector<size_t>({1, 7, 18}));
+		REQUIRE(target.tell() == 12);
+		target.insertAtCursors(value.begin(), value.end());
+		REQUIRE(readAll(target) == "**Hello** big World**");
+	}
+
+	SECTION("erase at cursors"){
+		target.addCursor(0);
+		target.addCursor(2);
+		target.addCursor(6);
+		target.go(8);
+		target.eraseAtCursors(3);
+		REQUIRE(readAll(target) == " ld");
+		REQUIRE(target.cursors().positions() == std::vector<size_t>({0, 0, 1}));
+		REQUIRE(target.tell() == 1);
+		target.flush();
+		REQUIRE(getFileContent(path1) == " ld");
+	}
+}
+
+TEST_CASE("Memory Target Lines", "[target]"){
+	auto path1 = TEST_FILE("test1.txt");
+	populateFile(path1, "one\ntwo\nthree\n\nfive");
+	MemoryTarget target{path1};
+
+	SECTION("original lines"){
+		REQUIRE(target.lines() == 5);
+		REQUIRE(target.lineStart(0) == 0);
+		REQUIRE(target.lineStart(2) == 8);
+		REQUIRE(target.lineStart(4) == 15);
+		REQUIRE(target.lineStart(5) == target.size());
+		target.goLine(2);
+		REQUIRE(target.tell() == 8);
+		REQUIRE(target.line() == 2);
+		target.goLine(42);
+		REQUIRE(target.line() == 4);
+	}
+
+	SECTION("edited lines"){
+		target.goLine(1);
+		insert(target, "1.5\n");
+		REQUIRE(target.lines() == 6);
+		REQUIRE(target.lineStart(2) == 8);
+		REQUIRE(target.line() == 2);
+		target.goLine(0);
+		target.go(2);
+		target.erase(8);
+		REQUIRE(readAll(target) == "ono\nthree\n\nfive");
+		REQUIRE(target.lines() == 4);
+		REQUIRE(target.lineStart(3) == 11);
+		target.goLine(2);
+		replace(target, "x\ny");
+		REQUIRE(readAll(target) == "ono\nthree\nx\nyve");
+		REQUIRE(target.lines() == 4);
+		REQUIRE(target.lineStart(3) == 12);
+		target.flush();
+		REQUIRE(target.lines() == 4);
+		target.goLine(3);
+		REQUIRE(target.tell() == 12);
+		REQUIRE(target.line() == 3);
+	}
+
+	SECTION("lines at cursors"){
+		target.addCursor(3);
+		target.addCursor(7);
+		std::string value = "\n";
+		target.insertAtCursors(value.begin(), value.end());
+		REQUIRE(target.lines() == 7);
+		target.eraseAtCursors(1);
+		REQUIRE(readAll(target) == "one\ntwo\nthree\n\nfive");
+		REQUIRE(target.lines() == 5);
+		REQUIRE(target.lineStart(3) == 14);
+	}
+}
+
+TEST_CASE("Memory Target Codepoints", "[target]"){
+	auto path = TEST_FILE("codepoints.txt");
+	//Long enough for the multibyte characters to be past the first mask word.
+	populateFile(path, (std::string(70, 'a') + "\xc3\xa9\xe6\x97\xa5\xe6\x9c\xacx").c_str());
+	MemoryTarget target(path);
+	SECTION("original codepoints"){
+		REQUIRE(target.utf8());
+		REQUIRE(target.size() == 79);
+		REQUIRE(target.codepoints() == 74);
+		REQUIRE(target.codepointStart(71) == 72);
+		REQUIRE(target.codepointStart(73) == 78);
+		REQUIRE(target.codepointStart(74) == 79);
+		target.go(74);
+		REQUIRE(target.codepoint() == 71);
+	}
+	SECTION("codepoint navigation"){
+		target.goCodepoints(72);
+		REQUIRE(target.tell() == 75);
+		target.goCodepoints(-2);
+		REQUIRE(target.tell() == 70);
+		target.goCodepoints(-100);
+		REQUIRE(target.tell() == 0);
+		target.goCodepoints(100);
+		REQUIRE(target.tell() == 79);
+	}
+	SECTION("codepoint editing"){
+		target.go(73);
+		target.eraseCodepoints(1);
+		REQUIRE(target.tell() == 72);
+		REQUIRE(target.codepoints() == 73);
+		REQUIRE(readRange(target, 70, 6) == "\xc3\xa9\xe6\x9c\xacx");
+		insert(target, "\xc3\xbc");
+		REQUIRE(target.codepoints() == 74);
+		REQUIRE(target.codepointStart(72) == 74);
+		target.toStart();
+		target.eraseCodepoints(71);
+		REQUIRE(target.codepoints() == 3);
+		REQUIRE(target.codepointStart(1) == 2);
+		target.flush();
+		REQUIRE(target.utf8());
+		REQUIRE(target.codepoints() == 3);
+		REQUIRE(target.codepointStart(2) == 5);
+	}
+	SECTION("empty file"){
+		populateFile(path, "");
+		MemoryTarget empty(path);
+		REQUIRE(empty.codepoints() == 0);
+		REQUIRE(empty.codepointStart(0) == 0);
+		empty.goCodepoints(1);
+		REQUIRE(empty.tell() == 0);
+	}
+	SECTION("invalid content"){
+		populateFile(path, "ab\xff\xc3");
+		MemoryTarget invalid(path);
+		REQUIRE_FALSE(invalid.utf8());
+		REQUIRE(invalid.codepoints() == 4);
+	}
+}
+
+TEST_CASE("Memory Target Streaming Open", "[target]"){
+	auto path = TEST_FILE("streaming.txt");
+	//Several index blocks, so the queries run while it is indexed.
+	std::string line = "0123456789abcdef0123456789abcdef0123456789abcdef012345678\xc3\xa9\n";
+	std::string content;
+	while (content.size() < 3 * 1024 * 1024) {
+		content += line;
+	}
+	populateFile(path, content.c_str());
+	MemoryTarget target(path);
+	REQUIRE(target.hasLine(0));
+	REQUIRE(target.lineStart(1) == 60);
+	target.goLine(2);
+	insert(target, "x\n");
+	REQUIRE(target.line() == 3);
+	REQUIRE(readRange(target, 119, 4) == "\nx\n0");
+
+	size_t lines = content.size() / line.size() + 2;
+	REQUIRE(target.lines() == lines);
+	REQUIRE(target.indexed());
+	REQUIRE(target.hasLine(lines - 1));
+	REQUIRE_FALSE(target.hasLine(lines));
+	REQUIRE(target.codepoints() == content.size() / line.size() * 59 + 2);
+	REQUIRE(target.encoding() == Encoding::UTF8);
+	target.goLine(lines + 10);
+	REQUIRE(target.tell() == long(target.size()));
+
+	target.flush();
+	REQUIRE(target.lines() == lines);
+	target.goLine(3);
+	REQUIRE(target.tell() == 122);
+
+	//Flushed at once, with a register on content likely not indexed yet.
+	MemoryTarget early(path);
+	early.toEnd();
+	early.go(-120);
+	early.copy(120);
+	early.flush();
+	REQUIRE(early.lines() == lines);
+	size_t codepoints = early.codepoints();
+	early.toEnd();
+	early.paste();
+	REQUIRE(early.lines() == lines + 2);
+	REQUIRE(early.codepoints() == codepoints + 2 * 59);
+}
+
+TEST_CASE("Memory Target Flush", "[target]"){
+	auto path = TEST_FILE("flush.txt");
+	std::string expected;
+	for (size_t i = 0; expected.size() < 200000; ++i) {
+		expected += std::to_string(i) + ' ';
+	}
+	populateFile(path, expected.c_str());
+	MemoryTarget target(path);
+	//Edits of every kind and size, so the original ranges move both ways.
+	unsigned seed = 42;
+	auto random = [&seed](size_t limit) {
+		seed = seed * 1103515245 + 12345;
+		return (seed >> 8) % (limit + 1);
+	};
+	for (int round = 0; round < 5; ++round) {
+		for (int i = 0; i < 20; ++i) {
+			size_t pos = random(expected.size());
+			std::string value(random(i % 2 ? 20 : 3000), char('a' + i));
+			target.toStart();
+			target.go(pos);
+			switch (random(2)) {
+			case 0:
+				insert(target, value);
+				expected.insert(pos, value);
+				break;
+			case 1:
+				target.erase(value.size());
+				expected.erase(pos, value.size());
+				break;
+			default:
+				replace(target, value);
+				expected.replace(pos, value.size(), value);
+				break;
+			}
+		}
+		target.flush();
+		std::ifstream f { path, ios_base::binary };
+		REQUIRE(std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()) == expected);
+		REQUIRE(readAll(target) == expected);
+	}
+}
+
+TEST_CASE("Memory Target Memory Budget", "[target]"){
+	auto path = TEST_FILE("budget.txt");
+	populateFile(path, "Hello World\n");
+	MemoryTarget target(path);
+	target.setMemoryBudget(16 * 1024);
+	std::string expected = "Hello World\n";
+	auto block = [](char ch) {
+		std::string value(6000, ch);
+		value[100] = '\n';
+		value[200] = '\xc3';
+		value[201] = '\xa9';
+		return value;
+	};
+	for (char ch = 'a'; ch < 'h'; ++ch) {
+		std::string value = block(ch);
+		size_t pos = (ch - 'a') * 4007 % (expected.size() + 1);
+		target.toStart();
+		target.go(pos);
+		insert(target, value);
+		expected.insert(pos, value);
+	}
+	REQUIRE(target.residentSize() <= 16 * 1024);
+	REQUIRE(readAll(target) == expected);
+	REQUIRE(target.lines() == 9);
+	REQUIRE(target.codepoints() == expected.size() - 7);
+	REQUIRE(target.lineStart(3) == expected.find('\n', target.lineStart(2)) + 1);
+
+	SECTION("edit spilled content"){
+		target.toStart();
+		target.go(10000);
+		insert(target, "xyz");
+		expected.insert(10000, "xyz");
+		target.go(500);
+		target.erase(9000);
+		expected.erase(10503, 9000);
+		target.toStart();
+		target.go(30000);
+		replace(target, "REPLACED");
+		expected.replace(30000, 8, "REPLACED");
+		REQUIRE(readAll(target) == expected);
+		REQUIRE(std::string(target.begin() + 9990, target.begin() + 10010) == expected.substr(9990, 20));
+		REQUIRE(target.codepoints() == countText(expected.begin(), expected.end()).codepoints);
+		target.goLine(5);
+		REQUIRE(target.line() == 5);
+	}
+	SECTION("flush spilled content"){
+		target.flush();
+		REQUIRE(target.residentSize() == 0);
+		REQUIRE(readAll(target) == expected);
+	}
+}
+
+TEST_CASE("Memory Target Adopted Buffers", "[target]"){
+	auto path = TEST_FILE("adopted.txt");
+	populateFile(path, "Hello World\n");
+	MemoryTarget target(path);
+	std::string expected = "Hello World\n";
+	std::string blob;
+	for (size_t i = 0; blob.size() < 3 * TextChunk::CAPACITY; ++i) {
+		blob += "gener\xc3\xa4ted " + std::to_string(i) + "\n";
+	}
+	auto shared = std::make_shared<const std::string>(blob);
+	target.go(6);
+	target.insert(std::string(blob));
+	expected.insert(6, blob);
+	target.insert(shared);
+	expected.insert(6 + blob.size(), blob);
+	target.insert(std::vector<char>(blob.begin(), blob.begin() + 10));
+	expected.insert(6 + 2 * blob.size(), blob.substr(0, 10));
+	REQUIRE(target.tell() == 6 + 2 * blob.size() + 10);
+	REQUIRE(readAll(target) == expected);
+	REQUIRE(target.lines() == size_t(std::count(expected.begin(), expected.end(), '\n')) + 1);
+	REQUIRE(target.codepoints() == countText(expected.begin(), expected.end()).codepoints);
+
+	SECTION("edit adopted content"){
+		target.toStart();
+		target.go(100);
+		target.erase(50);
+		expected.erase(100, 50);
+		insert(target, "xyz");
+		expected.insert(100, "xyz");
+		target.toStart();
+		target.go(blob.size());
+		target.replace(std::vector<char>(blob.rbegin(), blob.rend()));
+		expected.replace(blob.size(), blob.size(), std::string(blob.rbegin(), blob.rend()));
+		REQUIRE(readAll(target) == expected);
+		REQUIRE(std::string(target.begin() + 90, target.begin() + 110) == expected.substr(90, 20));
+		target.goLine(300);
+		REQUIRE(target.line() == 300);
+		REQUIRE(target.tell() == target.lineStart(300));
+		REQUIRE(*shared == blob);
+	}
+	SECTION("replace past the end"){
+		target.toEnd();
+		target.go(-5);
+		target.replace(std::string(blob));
+		expected.replace(expected.size() - 5, 5, blob);
+		REQUIRE(readAll(target) == expected);
+		REQUIRE(target.size() == expected.size());
+	}
+	target.flush();
+	REQUIRE(readAll(target) == expected);
+	std::ifstream f { path, ios_base::binary };
+	REQUIRE(std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()) == expected);
+}
+
+TEST_CASE("Memory Target Insert File", "[target]"){
+	auto path = TEST_FILE("spliced.txt");
+	auto sourcePath = TEST_FILE("source.txt");
+	populateFile(path, "Hello World\n");
+	std::string source;
+	for (size_t i = 0; source.size() < 5 * TextChunk::CAPACITY; ++i) {
+		source += "source line " + std::to_string(i) + "\n";
+	}
+	{
+		std::ofstream f { sourcePath, ios_base::binary };
+		f << source;
+	}
+	MemoryTarget target(path);
+	std::string expected = "Hello World\n";
+	target.go(6);
+	target.insertFile(sourcePath, 100, 3 * TextChunk::CAPACITY);
+	expected.insert(6, source.substr(100, 3 * TextChunk::CAPACITY));
+	target.toEnd();
+	target.insertFile(sourcePath);
+	expected += source;
+	target.insertFile(sourcePath, source.size() - 10, 1000);
+	expected += source.substr(source.size() - 10);
+	REQUIRE(target.tell() == expected.size());
+	REQUIRE(readAll(target) == expected);
+	REQUIRE(target.lines() == size_t(std::count(expected.begin(), expected.end(), '\n')) + 1);
+
+	SECTION("edit spliced content"){
+		target.toStart();
+		target.go(1000);
+		target.erase(5000);
+		expected.erase(1000, 5000);
+		insert(target, "xyz");
+		expected.insert(1000, "xyz");
+		REQUIRE(readAll(target) == expected);
+	}
+	SECTION("the target itself is copied"){
+		target.toStart();
+		target.insertFile(path);
+		expected.insert(0, "Hello World\n");
+		REQUIRE(readAll(target) == expected);
+	}
+	target.flush();
+	REQUIRE(readAll(target) == expected);
+	std::ifstream f { path, ios_base::binary };
+	REQUIRE(std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()) == expected);
+}
+
+TEST_CASE("Memory Target Registers", "[target]"){
+	auto path = TEST_FILE("registers.txt");
+	std::string expected;
+	for (size_t i = 0; expected.size() < 4 * TextChunk::CAPACITY; ++i) {
+		expected += "original line " + std::to_string(i) + "\n";
+	}
+	populateFile(path, expected.c_str());
+	MemoryTarget target(path);
+	target.setMemoryBudget(8 * 1024);
+	std::string modified(3 * TextChunk::CAPACITY, 'm');
+	target.go(5000);
+	insert(target, modified);
+	expected.insert(5000, modified);
+	target.toStart();
+	target.go(4000);
+	target.copy(10000);
+	std::string copied = expected.substr(4000, 10000);
+	REQUIRE(target.registerSize() == 10000);
+	REQUIRE(target.tell() == 4000);
+	REQUIRE(readAll(target) == expected);
+
+	SECTION("paste"){
+		target.toEnd();
+		target.paste();
+		expected += copied;
+		target.toStart();
+		target.paste();
+		expected.insert(0, copied);
+		REQUIRE(target.tell() == 10000);
+		REQUIRE(readAll(target) == expected);
+		REQUIRE(target.lines() == size_t(std::count(expected.begin(), expected.end(), '\n')) + 1);
+		target.flush();
+		std::ifstream f { path, ios_base::binary };
+		REQUIRE(std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()) == expected);
+	}
+	SECTION("edits do not change the register"){
+		target.toStart();
+		target.paste();
+		expected.insert(0, copied);
+		target.toStart();
+		target.go(6000);
+		target.erase(10000);
+		expected.erase(6000, 10000);
+		target.go(-3000);
+		insert(target, "xyz");
+		expected.insert(3000, "xyz");
+		REQUIRE(readAll(target) == expected);
+		target.toEnd();
+		target.paste();
+		expected += copied;
+		REQUIRE(readAll(target) == expected);
+	}
+	SECTION("cut"){
+		target.cut(6000, 'a');
+		expected.erase(4000, 6000);
+		std::string cut = copied.substr(0, 6000);
+		REQUIRE(target.registerSize('a') == 6000);
+		target.toEnd();
+		target.paste('a');
+		expected += cut;
+		target.paste('b');
+		REQUIRE(readAll(target) == expected);
+	}
+	SECTION("paste original content before its source"){
+		target.toStart();
+		target.go(20000);
+		target.copy(2000);
+		copied = expected.substr(20000, 2000);
+		target.toStart();
+		target.paste();
+		expected.insert(0, copied);
+		target.flush();
+		REQUIRE(readAll(target) == expected);
+		std::ifstream f { path, ios_base::binary };
+		REQUIRE(std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()) == expected);
+	}
+	SECTION("paste twice over the budget"){
+		target.toStart();
+		target.go(5000);
+		target.copy(modified.size());
+		target.paste();
+		target.paste();
+		expected.insert(5000, modified + modified);
+		target.toEnd();
+		target.setMemoryBudget(1024);
+		REQUIRE(readAll(target) == expected);
+		target.toStart();
+		target.paste();
+		expected.insert(0, modified);
+		REQUIRE(readAll(target) == expected);
+		target.flush();
+		std::ifstream f { path, ios_base::binary };
+		REQUIRE(std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()) == expected);
+	}
+	SECTION("registers survive the flush"){
+		target.flush();
+		REQUIRE(readAll(target) == expected);
+		target.toStart();
+		target.erase(expected.size());
+		target.flush();
+		target.paste();
+		target.paste();
+		target.flush();
+		REQUIRE(readAll(target) == copied + copied);
+		std::ifstream f { path, ios_base::binary };
+		REQUIRE(std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()) == copied + copied);
+	}
+}
+
+TEST_CASE("Memory Target Move", "[target]"){
+	auto path = TEST_FILE("moved.txt");
+	std::string expected;
+	for (size_t i = 0; expected.size() < 8 * TextChunk::CAPACITY; ++i) {
+		expected += "moved line " + std::to_string(i) + "\n";
+	}
+	populateFile(path, expected.c_str());
+	MemoryTarget target(path);
+	target.go(3000);
+	insert(target, "inserted");
+	expected.insert(3000, "inserted");
+	auto move = [&](size_t pos, size_t count, size_t destination) {
+		target.move(pos, count, destination);
+		std::string range = expected.substr(pos, count);
+		if (destination < pos) {
+			expected.erase(pos, count);
+			expected.insert(destination, range);
+		} else if (destination > pos + count) {
+			expected.insert(destination, range);
+			expected.erase(pos, count);
+		}
+	};
+
+	SECTION("forward"){
+		move(1000, 5000, 20000);
+		REQUIRE(target.tell() == 20000);
+		REQUIRE(readAll(target) == expected);
+	}
+	SECTION("backward"){
+		move(20000, 5000, 1000);
+		REQUIRE(target.tell() == 6000);
+		REQUIRE(readAll(target) == expected);
+	}
+	SECTION("inside itself"){
+		move(1000, 5000, 3000);
+		REQUIRE(readAll(target) == expected);
+	}
+	SECTION("to the ends"){
+		move(0, 100, expected.size());
+		move(expected.size() - 5000, 5000, 0);
+		REQUIRE(readAll(target) == expected);
+	}
+	SECTION("many moves"){
+		for (size_t i = 0; i < 100; ++i) {
+			move(i * 97 % 20000, 1 + i * 31 % 7000, i * 7919 % expected.size());
+		}
+		REQUIRE(readAll(target) == expected);
+		REQUIRE(target.lines() == size_t(std::count(expected.begin(), expected.end(), '\n')) + 1);
+	}
+	target.flush();
+	REQUIRE(readAll(target) == expected);
+	std::ifstream f { path, ios_base::binary };
+	REQUIRE(std::string(std::istreambuf_iterator<char>(f), std::istreambuf_iterator<char>()) == expected);
+}
+
+TEST_CASE("Memory Target Stats", "[target]"){
+	auto path = TEST_FILE("stats.txt");
+	populateFile(path, "Hello World\n");
+	MemoryTarget target(path);
+	auto stats = target.stats();
+	REQUIRE(stats.tree.originalLeaves == 1);
+	REQUIRE(stats.tree.branches == 0);
+	REQUIRE(stats.tree.depth == 1);
+	REQUIRE(stats.flushes == 0);
+
+	size_t allocations = stats.nodeAllocations;
+	target.go(6);
+	insert(target, "Big ");
+	REQUIRE(readAll(target) == "Hello Big World\n");
+	stats = target.stats();
+	REQUIRE(stats.tree.originalLeaves == 2);
+	REQUIRE(stats.tree.modifiedLeaves == 1);
+	REQUIRE(stats.tree.branches == 2);
+	REQUIRE(stats.tree.depth == 3);
+	REQUIRE(stats.tree.modifiedBytes == 4);
+	REQUIRE(stats.nodeAllocations > allocations);
+	REQUIRE(stats.originalBytesRead >= 12);
+	REQUIRE(stats.originalReads > 0);
+
+	target.flush();
+	stats = target.stats();
+	REQUIRE(stats.flushes == 1);
+	REQUIRE(stats.flushedBytes == 4 + 6);
+	REQUIRE(stats.tree.originalLeaves == 1);
+	REQUIRE(stats.tree.modifiedBytes == 0);
+	std::ostringstream out;
+	out << stats;
+	REQUIRE(out.str().find("flushed bytes: 10") != std::string::npos);
+}
+
+TEST_CASE("Memory Node Split and Concat", "[target]"){
+	auto path = TEST_FILE("node.txt");
+	populateFile(path, "");
+	FileTarget file(path);
+	auto content = [&file](MemoryNode const& node) {
+		std::string buffer;
+		node.viewRange(0, node.size(), back_inserter(buffer), file);
+		return buffer;
+	};
+	std::string text;
+	for (size_t i = 0; text.size() < 10 * TextChunk::CAPACITY; ++i) {
+		text += "node line " + std::to_string(i) + "\n";
+	}
+	MemoryNode node(text.begin(), text.end());
+	auto shared = std::make_shared<const std::string>(text);
+	node.insertShared(1000, std::shared_ptr<const char>(shared, shared->data()), shared->size());
+	std::string expected = text;
+	expected.insert(1000, text);
+	REQUIRE(content(node) == expected);
+
+	for (size_t pos : { size_t(0), size_t(1), size_t(999), size_t(1000), size_t(5000), text.size() + 1000,
+			expected.size() - 1, expected.size(), expected.size() + 10 }) {
+		MemoryNode left(node);
+		auto rest = left.split(pos);
+		size_t middle = std::min(pos, expected.size());
+		REQUIRE(content(left) == expected.substr(0, middle));
+		REQUIRE(content(*rest) == expected.substr(middle));
+		REQUIRE(left.counts().newlines == countText(expected.begin(), expected.begin() + middle).newlines);
+		REQUIRE(rest->counts().newlines == countText(expected.begin() + middle, expected.end()).newlines);
+		REQUIRE(content(node) == expected);
+
+		TextCounts appended = left.concat(rest);
+		REQUIRE(appended.codepoints == ptrdiff_t(expected.size() - middle));
+		REQUIRE(content(left) == expected);
+		REQUIRE(left.findNewline(500) == node.findNewline(500));
+	}
+	SECTION("concat shares the content"){
+		MemoryNode copy(node);
+		copy.concat(copy.split(1000));
+		node.concat(std::shared_ptr<MemoryNode>(new MemoryNode(copy)));
+		node.erase(0, 10);
+		REQUIRE(content(copy) == expected);
+		REQUIRE(content(node) == expected.substr(10) + expected);
+	}
+}
+
+TEST_CASE("Cursor Set Test", "[cursor]"){
+	CursorSet cursors;
+	cursors.assign({1, 3, 3, 7, 12, 20});
+	REQUIRE(cursors.positions() == std::vector<size_t>({1, 3, 3, 7, 12, 20}));
+	REQUIRE(cursors[3] == 7);
+	REQUIRE(cursors.lowerBound(3) == 1);
+	REQUIRE(cursors.lowerBound(4) == 3);
+	REQUIRE(cursors.lowerBound(21) == 6);
+	cursors.shift(7, 5);
+	REQUIRE(cursors.positions() == std::vector<size_t>({1, 3, 3, 12, 17, 25}));
+	cursors.collapse(2, 12);
+	REQUIRE(cursors.positions() == std::vector<size_t>({1, 2, 2, 2, 5, 13}));
+	cursors.add(4);
+	cursors.remove(0);
+	REQUIRE(cursors.positions() == std::vector<size_t>({2, 2, 2, 4, 5, 13}));
 }
 
@@ -0,0 +1,84 @@
+/**
+ * @file MmapTargetTest.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include "../src/MmapTarget.hpp"
+
+#include "catch.hpp"
+#include "fileUtils.hpp"
+
+inline std::string read(MmapTarget &target, long count){
+	std::string buffer;
+	target.view(count, back_inserter(buffer));
+	return buffer;
+}
+
+inline void write(MmapTarget &target, std::string const &buffer){
+	target.replace(buffer.begin(), buffer.end());
+}
+
+TEST_CASE("MmapTarget Happy", "[target]") {
+	auto path1 = TEST_FILE("test1.txt");
+	populateFile(path1, "Hello World\n");
+
+	MmapTarget target { path1 };
+
+	SECTION("Read"){
+		REQUIRE(read(target, 12) == "Hello World\n");
+		REQUIRE(std::string(target.data(), target.size()) == "Hello World\n");
+	}
+
+	SECTION("Tell"){
+		REQUIRE(target.tell() == 0);
+		read(target, 12);
+		REQUIRE(target.tell() == 12);
+	}
+
+	SECTION("go"){
+		target.go(7);
+		REQUIRE(target.tell() == 7);
+		target.go(-2);
+		REQUIRE(target.tell() == 5);
+		target.go(4);
+		REQUIRE(target.tell() == 9);
+		target.go(-20);
+		REQUIRE(target.tell() == 0);
+		target.go(20);
+		REQUIRE(target.tell() == 12);
+	}
+
+	SECTION("Write"){
+		REQUIRE_NOTHROW(write(target, "Weird"));
+		target.toStart();
+		REQUIRE(read(target, 12) == "Weird World\n");
+		target.toEnd();
+		target.go(-1);
+		REQUIRE_NOTHROW(write(target, "!!!"));
+		target.toStart();
+		REQUIRE(read(target, 14) == "Weird World!!!");
+		target.flush();
+		REQUIRE(getFileContent(path1) == "Weird World!!!");
+	}
+
+	SECTION("Shrink"){
+		target.go(5);
+		target.shrink();
+		REQUIRE(target.size() == 5);
+		REQUIRE(getFileContent(path1) == "Hello");
+	}
+}
+
+TEST_CASE("MmapTarget with empty file", "[target]") {
+	auto path1 = TEST_FILE("empty.txt");
+	populateFile(path1, "");
+	MmapTarget target { path1 };
+	REQUIRE(target.size() == 0);
+	REQUIRE(read(target, 10) == "");
+	target.go(-5);
+	REQUIRE(target.tell() == 0);
+	write(target, "Hi");
+	REQUIRE(std::string(target.data(), target.size()) == "Hi");
+}
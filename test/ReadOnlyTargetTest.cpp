@@ -0,0 +1,56 @@
+/**
+ * @file ReadOnlyTargetTest.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include "../src/ReadOnlyTarget.hpp"
+
+#include "catch.hpp"
+#include "fileUtils.hpp"
+
+static_assert(!isWritableTarget<ReadOnlyTarget>, "Read only targets must not be writable");
+
+inline std::string read(ReadOnlyTarget &target, long count){
+	std::string buffer;
+	target.view(count, back_inserter(buffer));
+	return buffer;
+}
+
+TEST_CASE("ReadOnlyTarget Happy", "[target]") {
+	auto path1 = TEST_FILE("readonly.txt");
+	populateFile(path1, "one\ntwo\nthree\n");
+
+	ReadOnlyTarget target { path1 };
+
+	SECTION("Read"){
+		REQUIRE(read(target, 8) == "one\ntwo\n");
+		REQUIRE(target.tell() == 8);
+		REQUIRE(std::string(target.data(), target.size()) == "one\ntwo\nthree\n");
+	}
+
+	SECTION("Lines"){
+		REQUIRE(target.lines() == 4);
+		REQUIRE(target.indexed());
+		REQUIRE(target.lineStart(2) == 8);
+		target.goLine(10);
+		REQUIRE(target.tell() == 14);
+		target.go(-3);
+		REQUIRE(target.line() == 2);
+	}
+
+	SECTION("go"){
+		target.go(-5);
+		REQUIRE(target.tell() == 0);
+		target.go(20);
+		REQUIRE(target.tell() == 14);
+	}
+}
+
+TEST_CASE("ReadOnlyTarget does not create files", "[target]") {
+	auto path1 = TEST_FILE("readonly_missing.txt");
+	std::remove(path1);
+	REQUIRE_THROWS(ReadOnlyTarget { path1 });
+	REQUIRE_FALSE(std::ifstream(path1));
+}
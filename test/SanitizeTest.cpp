@@ -0,0 +1,52 @@
+/**
+ * @file SanitizeTest.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include "../src/Sanitize.hpp"
+
+#include "catch.hpp"
+
+using namespace sweet;
+
+inline std::string sanitized(std::string const &v, DisplayPolicy policy){
+	std::string out;
+	sanitize(v.data(), v.data() + v.size(), out, policy);
+	return out;
+}
+
+TEST_CASE("Sanitize Test", "[display]"){
+	//Long enough to go through both the vector and the scalar paths.
+	std::string text = "Hello World, this is a long line\twith \x7f and \x01 \xc3\xa9\xff!";
+	SECTION("printable"){
+		std::string printable = "Hello World, this is a long line with no control.";
+		REQUIRE(sanitized(printable, DisplayPolicy::REPLACE) == printable);
+		REQUIRE(sanitized(printable, DisplayPolicy::HEX) == printable);
+	}
+	SECTION("replace"){
+		REQUIRE(sanitized(text, DisplayPolicy::REPLACE) ==
+				"Hello World, this is a long line?with ? and ? ??" "?!");
+	}
+	SECTION("caret"){
+		REQUIRE(sanitized(text, DisplayPolicy::CARET) ==
+				"Hello World, this is a long line^Iwith ^? and ^A M-CM-)M-^?!");
+	}
+	SECTION("hex"){
+		REQUIRE(sanitized(text, DisplayPolicy::HEX) ==
+				"Hello World, this is a long line\\x09with \\x7f and \\x01 \\xc3\\xa9\\xff!");
+	}
+	SECTION("utf8"){
+		REQUIRE(sanitized(text, DisplayPolicy::UTF8) ==
+				"Hello World, this is a long line?with ? and ? \xc3\xa9?!");
+		REQUIRE(sanitized("\xc3", DisplayPolicy::UTF8) == "?");
+		REQUIRE(sanitized("\xed\xa0\x80", DisplayPolicy::UTF8) == "???");
+	}
+	SECTION("parse policy"){
+		DisplayPolicy policy;
+		REQUIRE(parseDisplayPolicy("caret", policy));
+		REQUIRE(policy == DisplayPolicy::CARET);
+		REQUIRE_FALSE(parseDisplayPolicy("colors", policy));
+	}
+}
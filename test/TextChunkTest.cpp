@@ -0,0 +1,146 @@
+/**
+ * @file TextChunkTest.cpp
+ *
+ * @date 2026-10-19
+ * @author talesm
+ */
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include "../src/MemoryTarget.hpp"
+#include "../src/TextChunk.hpp"
+
+#include "catch.hpp"
+#include "fileUtils.hpp"
+
+TEST_CASE("Text Chunk", "[chunk]"){
+	std::string text = "Hello World";
+	TextChunk chunk(text.begin(), text.end());
+	REQUIRE(chunk.size() == 11);
+	REQUIRE(chunk.room() == TextChunk::CAPACITY - 11);
+
+	SECTION("insert"){
+		std::string big = "Big ";
+		chunk.insert(6, big.begin(), big.end());
+		REQUIRE(std::string(chunk.begin(), chunk.end()) == "Hello Big World");
+	}
+	SECTION("replace"){
+		std::string other = "Folks!";
+		chunk.replace(6, other.begin(), other.end());
+		REQUIRE(std::string(chunk.begin(), chunk.end()) == "Hello Folks!");
+	}
+	SECTION("erase"){
+		chunk.erase(5, 100);
+		REQUIRE(std::string(chunk.begin(), chunk.end()) == "Hello");
+	}
+	SECTION("typing burst"){
+		std::string typed = "Big ";
+		for (size_t i = 0; i < typed.size(); ++i) {
+			chunk.insert(6 + i, typed.begin() + i, typed.begin() + i + 1);
+		}
+		chunk.erase(9, 1);
+		chunk.erase(8, 1);
+		REQUIRE(chunk[5] == ' ');
+		REQUIRE(chunk[8] == 'W');
+		std::string spans;
+		chunk.forEachSpan(2, 100, [&spans](const char *first, const char *last) {
+			spans += std::string(first, last) + "|";
+			return true;
+		});
+		REQUIRE(spans == "llo Bi|World|");
+		REQUIRE(std::string(chunk.begin(), chunk.end()) == "Hello BiWorld");
+	}
+	SECTION("overflow"){
+		std::string big(TextChunk::CAPACITY, 'x');
+		REQUIRE_THROWS_AS(chunk.insert(0, big.begin(), big.end()), std::length_error const&);
+		REQUIRE(chunk.size() == 11);
+	}
+	SECTION("growing"){
+		std::string mirror = text;
+		size_t allocations = TextChunk::allocations();
+		for (size_t i = 0; mirror.size() < TextChunk::CAPACITY; ++i) {
+			char c = 'a' + i % 26;
+			size_t pos = i * 7 % mirror.size();
+			chunk.insert(pos, &c, &c + 1);
+			mirror.insert(pos, 1, c);
+		}
+		REQUIRE(TextChunk::allocations() - allocations <= 7);
+		REQUIRE(chunk.room() == 0);
+		TextChunk copy(chunk);
+		REQUIRE(std::string(copy.begin(), copy.end()) == mirror);
+		REQUIRE(std::string(chunk.begin(), chunk.end()) == mirror);
+	}
+}
+
+TEST_CASE("Memory Target Chunked Edits", "[chunk]"){
+	auto path = TEST_FILE("chunked.txt");
+	populateFile(path, "Hello World");
+	MemoryTarget target(path);
+	std::string mirror = "Hello World";
+	std::string big;
+	for (size_t i = 0; big.size() < 3 * TextChunk::CAPACITY + 7; ++i) {
+		big += "line " + std::to_string(i) + "\n";
+	}
+	target.go(6);
+	target.insert(big.begin(), big.end());
+	mirror.insert(6, big);
+	REQUIRE(target.lines() == 1 + size_t(std::count(big.begin(), big.end(), '\n')));
+
+	SECTION("insert across chunks"){
+		for (size_t pos = 100; pos < mirror.size(); pos += 1500) {
+			target.toStart();
+			target.go(pos);
+			target.insert(big.begin(), big.begin() + 700);
+			mirror.insert(pos, big, 0, 700);
+		}
+		std::string buffer;
+		target.viewAll(back_inserter(buffer));
+		REQUIRE(buffer == mirror);
+	}
+	SECTION("typing past a chunk"){
+		target.toStart();
+		target.go(20);
+		for (size_t i = 0; i < 2 * TextChunk::CAPACITY; ++i) {
+			char c = 'a' + i % 26;
+			target.insert(&c, &c + 1);
+			mirror.insert(20 + i, 1, c);
+			if (i % 100 == 99) {
+				target.go(-1);
+				target.erase(1);
+				mirror.erase(20 + i, 1);
+				target.insert(&c, &c + 1);
+				mirror.insert(20 + i, 1, c);
+			}
+		}
+		std::string buffer;
+		target.viewAll(back_inserter(buffer));
+		REQUIRE(buffer == mirror);
+	}
+	SECTION("replace across chunks"){
+		target.toStart();
+		target.go(TextChunk::CAPACITY - 10);
+		std::string other(5000, '_');
+		target.replace(other.begin(), other.end());
+		mirror.replace(TextChunk::CAPACITY - 10, 5000, other);
+		std::string buffer;
+		target.viewAll(back_inserter(buffer));
+		REQUIRE(buffer == mirror);
+		REQUIRE(target.size() == mirror.size());
+	}
+	SECTION("erase across chunks"){
+		target.toStart();
+		target.go(50);
+		target.erase(2 * TextChunk::CAPACITY);
+		mirror.erase(50, 2 * TextChunk::CAPACITY);
+		std::string buffer;
+		target.viewAll(back_inserter(buffer));
+		REQUIRE(buffer == mirror);
+		REQUIRE(target.lines() == 1 + size_t(std::count(mirror.begin(), mirror.end(), '\n')));
+	}
+	target.flush();
+	//The file content is read without the newlines.
+	mirror.erase(std::remove(mirror.begin(), mirror.end(), '\n'), mirror.end());
+	REQUIRE(getFileContent(path) == mirror);
+}